@@ -1,19 +1,105 @@
 #define KEY_COUNT 2
 #define MAX_CANDLES 5000
+#define RATE_LIMIT 100
+#define RATE_BURST 20
 
+#include <atomic>
 #include <iostream>
 #include <api/client_api.h>
+#include <util/jsonreader.h>
+#include <util/oandacandles.h>
 #include <ctime>
 
 std::string accountid, token;
+// incremented on init so that every thread picks up the new token
+std::atomic<unsigned> token_generation(0);
+
+/**
+ * Each thread gets its own connection so that portfolios updating on
+ * different threads never share a socket. Timeouts keep a hung request
+ * from blocking its portfolio indefinitely.
+ */
+httplib::SSLClient& http()
+{
+	thread_local httplib::SSLClient client("api-fxpractice.oanda.com");
+	thread_local unsigned generation = 0;
+
+	unsigned current = token_generation.load();
+	if (generation != current)
+	{
+		client.set_bearer_token_auth(token.c_str());
+		client.set_connection_timeout(5);
+		client.set_read_timeout(10);
+		client.set_write_timeout(10);
+		generation = current;
+	}
+
+	return client;
+}
+
+// reads { "units": "1.0", "averagePrice": "1.0", ... } from a position side
+bool read_position_side(JsonReader& json, double& units, double& avg_price)
+{
+	if (json.next() != JSON_OBJECT) return false;
+
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
+	{
+		if (json.equals("units"))
+		{
+			json.next();
+			units = json.to_double();
+		}
+		else if (json.equals("averagePrice"))
+		{
+			json.next();
+			avg_price = json.to_double();
+		}
+		else if (!json.skip())
+		{
+			return false;
+		}
+	}
 
-httplib::SSLClient client("api-fxpractice.oanda.com");
+	return token == JSON_OBJECT_END;
+}
+
+bool read_fill(JsonReader& json, double& units, double& price, double& fee)
+{
+	if (json.next() != JSON_OBJECT) return false;
+
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
+	{
+		if (json.equals("units"))
+		{
+			json.next();
+			units = json.to_double();
+		}
+		else if (json.equals("price"))
+		{
+			json.next();
+			price = json.to_double();
+		}
+		else if (json.equals("commission") || json.equals("halfSpreadCost"))
+		{
+			json.next();
+			fee += json.to_double();
+		}
+		else if (!json.skip())
+		{
+			return false;
+		}
+	}
+
+	return token == JSON_OBJECT_END;
+}
 
 const char *init(const char** credentials)
 {
 	accountid = credentials[0];
 	token = credentials[1];
-	client.set_bearer_token_auth(token.c_str());
+	token_generation += 1;
 	return NULL;
 
 }
@@ -36,72 +122,60 @@ const char *get_price_history(PriceHistory* out, const char *ticker)
 
 	url += '?' + httplib::detail::params_to_query_str(p);
 	
-	auto res = client.Get(url.c_str());
+	auto res = http().Get(url.c_str());
 
 	// if there was an error, return it
 	const char *err = res_err(res);
 	if (err) return err;
 
-	Data json = Data::parse_json(res->body);
-	if (json.is_error())
-	{
-		return "json failed to parse";
-	}
-
-	const Data& candles_json = json["candles"];
-
-	if (candles_json.empty() || !candles_json.is_array())
-	{
-		return "no candles were received";
-	}
-	else if (candles_json.size() != hist.size())
-	{
-		return "not all candles were received";
-	}
-
-	for (int i = 0; i < hist.size(); i++)
-	{
-		const Data& candle = candles_json[i];
-		const Data& mid = candle["mid"];
-		
-		hist[i] =
-		{
-			mid["o"].to_double(),
-			mid["h"].to_double(),
-			mid["l"].to_double(),
-			mid["c"].to_double(),
-			candle["volume"].to_double()
-		};
-	}
-
-	return NULL;
+	return decode_oanda_candles(res->body, hist);
 }
 
 const char *get_account(Account *out)
 {
 	std::string url = "/v3/accounts/" + accountid + "/summary";
-	auto res = client.Get(url.c_str());
+	auto res = http().Get(url.c_str());
 
 	const char *err = res_err(res);
 	if (err) return err;
 
-	Data json = Data::parse_json(res->body);
-
-	if (json.is_error())
+	JsonReader json(res->body);
+	if (json.next() != JSON_OBJECT || !json.find("account") || json.next() != JSON_OBJECT)
 	{
 		return "json failed to parse";
 	}
 
-	const Data& acc = json["account"];
+	double balance = 0.0, margin_available = 0.0, margin_used = 0.0, nav = 0.0, margin_rate = 0.0;
 
-	double margin_rate = acc["marginRate"].to_double();
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
+	{
+		double *field = nullptr;
+		if (json.equals("balance")) field = &balance;
+		else if (json.equals("marginAvailable")) field = &margin_available;
+		else if (json.equals("marginUsed")) field = &margin_used;
+		else if (json.equals("NAV")) field = &nav;
+		else if (json.equals("marginRate")) field = &margin_rate;
+
+		if (field)
+		{
+			json.next();
+			*field = json.to_double();
+		}
+		else if (!json.skip())
+		{
+			return "json failed to parse";
+		}
+	}
+
+	if (token != JSON_OBJECT_END || margin_rate <= 0.0) return "json failed to parse";
 
 	*out =
 	{
-		acc["balance"].to_double(),
-		acc["marginAvailable"].to_double() / margin_rate,
-		acc["marginUsed"].to_double(),
-		acc["NAV"].to_double(),
+		balance,
+		margin_available / margin_rate,
+		margin_used,
+		nav,
 		(int)(1.0 / margin_rate),
 		true
 	};
@@ -109,7 +183,7 @@ const char *get_account(Account *out)
 	return NULL;
 }
 
-const char *market_order(const char *ticker, double amount)
+const char *market_order(Fill* out, const char *ticker, double amount)
 {
 	std::string url = "/v3/accounts/" + accountid + "/orders";
 
@@ -120,33 +194,51 @@ const char *market_order(const char *ticker, double amount)
 		{ "units", std::to_string(amount) }
 	});
 
-	auto res = client.Post(url.c_str(), req.to_json(), JSON_FORMAT);
+	auto res = http().Post(url.c_str(), req.to_json(), JSON_FORMAT);
 
 	// if error exit
 	const char *error = res_err(res);
 	if (error) return error;
 
-	Data json = Data::parse_json(res->body);
+	bool created = false, cancelled = false, filled = false;
+	double units = 0.0, price = 0.0, fee = 0.0;
 
-	if (json.is_error())
-	{
-		error = "json failed to parse";
-	}
+	JsonReader json(res->body);
+	if (json.next() != JSON_OBJECT) return "json failed to parse";
 
-	if (json["orderCreateTransaction"].is_null())
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
 	{
-		return "order was not created correctly";
-	}
+		bool ok = true;
+		if (json.equals("orderCreateTransaction"))
+		{
+			created = true;
+			ok = json.skip();
+		}
+		else if (json.equals("orderCancelTransaction"))
+		{
+			cancelled = true;
+			ok = json.skip();
+		}
+		else if (json.equals("orderFillTransaction"))
+		{
+			filled = true;
+			ok = read_fill(json, units, price, fee);
+		}
+		else
+		{
+			ok = json.skip();
+		}
 
-	if (json["orderCancelTransaction"].is_null())
-	{
-		return "order was cancelled";
+		if (!ok) return "json failed to parse";
 	}
 
-	if (json["orderFillTransaction"].is_null())
-	{
-		return "order was not fulfilled";
-	}
+	if (token != JSON_OBJECT_END) return "json failed to parse";
+	if (!created) return "order was not created correctly";
+	if (cancelled) return "order was cancelled";
+	if (!filled) return "order was not fulfilled";
+
+	*out = { units, price, fee };
 
 	return NULL;
 }
@@ -155,71 +247,111 @@ const char *get_position(Position* out, const char *ticker)
 {
 	// getting share count
 	std::string url = "/v3/accounts/" + accountid + "/positions/" + ticker;
-	auto res = client.Get(url.c_str());
+	auto res = http().Get(url.c_str());
 
 	const char *error = res_err(res);
 	if (error) return error;
 
-	Data json = Data::parse_json(res->body);
-	if (json.is_error())
+	JsonReader json(res->body);
+	if (json.next() != JSON_OBJECT || !json.find("position") || json.next() != JSON_OBJECT)
 	{
 		return "json failed to parse";
 	}
-	const Data& long_json = json["position"]["long"];
-	const Data& short_json = json["position"]["short"];
-	
-	double shares = short_json["units"].to_double() + long_json["units"].to_double();
+
+	double long_units = 0.0, long_price = 0.0, short_units = 0.0, short_price = 0.0;
+
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
+	{
+		bool ok = true;
+		if (json.equals("long")) ok = read_position_side(json, long_units, long_price);
+		else if (json.equals("short")) ok = read_position_side(json, short_units, short_price);
+		else ok = json.skip();
+
+		if (!ok) return "json failed to parse";
+	}
+
+	if (token != JSON_OBJECT_END) return "json failed to parse";
+
+	double shares = short_units + long_units;
 	double amt_invested = 0.0;
 
 	// long position
 	if (shares > 0.0)
 	{
-		amt_invested = shares * long_json["averagePrice"].to_double();
+		amt_invested = shares * long_price;
 	}
 	// short position
 	else if (shares < 0.0)
 	{
-		amt_invested = -shares * short_json["averagePrice"].to_double();
+		amt_invested = -shares * short_price;
 	}
 
-	// getting fee and price
-	url = "/v3/instruments/" + std::string(ticker) + "/candles?count=20&granularity=S5&price=BAM";
-	res = client.Get(url.c_str());
+	// the price and fee are filled in from the client's spread estimate
+	*out = { amt_invested, 0.0, 1.0, 0.0, shares };
+	
+	return NULL;
+}
 
-	// exit if error
-	error = res_err(res);
+const char *get_quote(double *price, double *spread, const char *ticker)
+{
+	std::string url = "/v3/accounts/" + accountid + "/pricing?instruments=" + ticker;
+	auto res = http().Get(url.c_str());
+
+	const char *error = res_err(res);
 	if (error) return error;
-	
-	
-	json = Data::parse_json(res->body);
-	if (json.is_error())
+
+	// reads { "prices": [{ "bids": [{ "price": "1.0" }], "asks": [{ "price": "1.0" }] }] }
+	JsonReader json(res->body);
+	if (json.next() != JSON_OBJECT || !json.find("prices") || json.next() != JSON_ARRAY
+		|| json.next() != JSON_OBJECT)
 	{
 		return "json failed to parse";
 	}
 
-	
-	auto candles = json["candles"].to_array();
-	double price = candles.back()["mid"]["c"].to_double();
+	double bid = 0.0, ask = 0.0;
 
-	// calculating half spread cost as a percentage
-	double fee = 0.0;
-	for (const Data& c : candles)
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
 	{
-		fee += (c["ask"]["c"].to_double() - c["bid"]["c"].to_double());
+		double *side = nullptr;
+		if (json.equals("bids")) side = &bid;
+		else if (json.equals("asks")) side = &ask;
+
+		if (!side)
+		{
+			if (!json.skip()) return "json failed to parse";
+			continue;
+		}
+
+		// the first entry of the order book is the best price
+		if (json.next() != JSON_ARRAY || json.next() != JSON_OBJECT || !json.find("price"))
+		{
+			return "json failed to parse";
+		}
+		json.next();
+		*side = json.to_double();
+
+		// skipping the rest of the entry and the deeper entries
+		while ((token = json.next()) != JSON_ARRAY_END)
+		{
+			if (token == JSON_END || token == JSON_ERROR) return "json failed to parse";
+			if (token == JSON_KEY && !json.skip()) return "json failed to parse";
+		}
 	}
-	fee /= ((double)candles.size() * 2.0);
-	fee /= price;
 
-	// constructing info
-	*out = { amt_invested, fee, 1.0, price, shares };
-	
+	if (token != JSON_OBJECT_END || bid <= 0.0 || ask <= 0.0) return "no prices were received";
+
+	*price = (bid + ask) / 2.0;
+	*spread = ask - bid;
+
 	return NULL;
 }
 
 const char *set_leverage(uint32_t multiplier)
 {
 	std::string url = "/v3/accounts/" + accountid + "/configuration";
-	client.Patch(url.c_str());
+	http().Patch(url.c_str());
 	if (multiplier > 50)
 	{
 		return "leverage higher than maximum (50) is not allowed";
@@ -230,7 +362,7 @@ const char *set_leverage(uint32_t multiplier)
 	}
 	Data req;
 	req["marginRate"] = std::to_string(1.0 / (double)multiplier);
-	auto res = client.Patch(url.c_str(), req.to_json(), JSON_FORMAT);
+	auto res = http().Patch(url.c_str(), req.to_json(), JSON_FORMAT);
 	
 	const char *error = res_err(res);
 	if (error) return error;
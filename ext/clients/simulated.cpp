@@ -0,0 +1,511 @@
+#define KEY_COUNT 1
+#define MAX_CANDLES 5000
+
+/**
+ * In-process simulated broker for load and latency testing of the trade
+ * loop. No network or credentials are needed.
+ *
+ * The single key is the path to a json settings file (or an empty string
+ * for the defaults below):
+ *
+ *	{
+ *		"seed": 1,				// random walk seed
+ *		"step": 5,				// seconds per simulated base candle
+ *		"speed": 1.0,			// simulated seconds per real second
+ *		"max_interval": 300,	// largest candle interval in seconds that is served
+ *		"price": 1.0,			// initial price of every instrument
+ *		"volatility": 0.1,		// annualized volatility of the random walk
+ *		"drift": 0.0,			// annualized drift of the random walk
+ *		"garch_alpha": 0.0,		// GARCH(1,1) weight of the last squared shock
+ *		"garch_beta": 0.0,		// GARCH(1,1) weight of the last variance
+ *		"regime_switch": 0.0,	// chance per candle of switching volatility regime
+ *		"regime_volatility": 0.4,	// annualized volatility of the second regime
+ *		"gap_chance": 0.0,		// chance per candle of opening away from the last close
+ *		"gap_size": 0.0,		// standard deviation of the log size of a gap
+ *		"spread": 0.0001,		// full bid/ask spread as a ratio of price
+ *		"slippage": 0.0,		// maximum extra slippage as a ratio of price
+ *		"latency": 0,			// microseconds before an order is filled
+ *		"balance": 10000.0,		// starting account balance
+ *		"leverage": 1,
+ *		"archive": ""			// folder of <ticker>.csv files to replay
+ *	}
+ *
+ * Archive files contain one "open,high,low,close,volume" line per base
+ * candle and are replayed in a loop instead of generating a random walk.
+ *
+ * Enough base candles are retained for MAX_CANDLES candles of every
+ * interval up to max_interval, which must be a multiple of the step.
+ * Larger intervals are not served, as they would need far more memory.
+ */
+
+#include <api/client_api.h>
+#include <data/marketgenerator.h>
+#include <util/jsonreader.h>
+
+// standard library
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Instrument
+{
+	std::deque<Candle> candles;
+	// base candle index of candles.back()
+	long long last = 0;
+	// close of the last generated candle, which positions are marked at
+	double close = 0.0;
+	MarketGenerator generator;
+	std::vector<Candle> archive;
+	double shares = 0.0;
+	double avg_price = 0.0;
+};
+
+struct Settings
+{
+	unsigned long long seed = 1;
+	unsigned step = SEC5;
+	double speed = 1.0;
+	unsigned max_interval = MIN5;
+	double price = 1.0;
+	double volatility = 0.1;
+	double drift = 0.0;
+	double garch_alpha = 0.0;
+	double garch_beta = 0.0;
+	double regime_switch = 0.0;
+	double regime_volatility = 0.4;
+	double gap_chance = 0.0;
+	double gap_size = 0.0;
+	double spread = 0.0001;
+	double slippage = 0.0;
+	unsigned latency = 0;
+	double balance = 10000.0;
+	unsigned leverage = 1;
+	std::string archive;
+};
+
+Settings settings;
+// base candles retained per instrument
+long long history = 0;
+MarketModel model;
+double balance = 0.0;
+std::unordered_map<std::string, Instrument> instruments;
+std::mutex mtx;
+std::mt19937_64 slippage_rng;
+
+// real and simulated time at which the simulation started
+std::chrono::steady_clock::time_point real_start;
+double sim_start = 0.0;
+
+double sim_seconds()
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - real_start;
+	return sim_start + elapsed.count() * settings.speed;
+}
+
+unsigned long long hash_ticker(const char *ticker)
+{
+	// fnv-1a so that seeds are stable between builds
+	unsigned long long hash = 14695981039346656037ULL;
+	for (const char *c = ticker; *c; ++c)
+	{
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::vector<Candle> read_archive(const std::string& ticker)
+{
+	std::vector<Candle> out;
+	std::ifstream file(settings.archive + "/" + ticker + ".csv");
+	std::string line;
+	while (std::getline(file, line))
+	{
+		double v[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+		std::istringstream ss(line);
+		for (int i = 0; i < 5 && ss >> v[i]; ++i) ss.ignore(1, ',');
+		if (v[3] > 0.0) out.push_back({ v[0], v[1], v[2], v[3], v[4] });
+	}
+	return out;
+}
+
+MarketModel market_model()
+{
+	MarketModel out;
+	out.interval = settings.step;
+	out.price = settings.price;
+	out.drift = settings.drift;
+	out.volatility = settings.volatility;
+	out.garch_alpha = settings.garch_alpha;
+	out.garch_beta = settings.garch_beta;
+	out.gap_chance = settings.gap_chance;
+	out.gap_size = settings.gap_size;
+	out.volume = 50.0;
+
+	if (settings.regime_switch > 0.0)
+	{
+		out.regimes = { { settings.drift, settings.volatility },
+			{ settings.drift, settings.regime_volatility } };
+		out.regime_switch = settings.regime_switch;
+	}
+
+	return out;
+}
+
+/**
+ * Gets an instrument with candles generated up to the last complete base
+ * candle. Must be called with the mutex locked.
+ */
+Instrument& get_instrument(const char *ticker)
+{
+	long long current = (long long)(sim_seconds() / settings.step) - 1;
+
+	auto iter = instruments.find(ticker);
+	if (iter == instruments.end())
+	{
+		Instrument& inst = instruments[ticker];
+		inst.generator = MarketGenerator(model, 1, settings.seed ^ hash_ticker(ticker));
+		if (!settings.archive.empty()) inst.archive = read_archive(ticker);
+		inst.last = current - history;
+		inst.close = settings.price;
+		iter = instruments.find(ticker);
+	}
+
+	Instrument& inst = iter->second;
+
+	// a long idle period only needs the retained history to be generated
+	if (current - inst.last > history)
+	{
+		inst.last = current - history;
+		inst.candles.clear();
+	}
+
+	if (inst.last >= current) return inst;
+
+	unsigned count = current - inst.last;
+	if (inst.archive.empty())
+	{
+		// generating every missing candle at once is much faster than one at a time
+		std::vector<Candle> generated(count);
+		inst.generator.generate(generated.data(), count);
+		inst.candles.insert(inst.candles.end(), generated.begin(), generated.end());
+	}
+	else
+	{
+		for (long long i = inst.last + 1; i <= current; ++i)
+		{
+			inst.candles.push_back(inst.archive[i % inst.archive.size()]);
+		}
+	}
+
+	inst.last = current;
+	inst.close = inst.candles.back().close();
+	while ((long long)inst.candles.size() > history) inst.candles.pop_front();
+
+	return inst;
+}
+
+const char *read_settings(const std::string& json_str)
+{
+	JsonReader json(json_str);
+	if (json.next() != JSON_OBJECT) return "settings must be a json object";
+
+	JsonToken token;
+	while ((token = json.next()) == JSON_KEY)
+	{
+		std::string key(json.view());
+		token = json.next();
+
+		if (key == "archive")
+		{
+			settings.archive = std::string(json.view());
+			continue;
+		}
+
+		if (token != JSON_NUMBER) return "settings values must be numbers";
+
+		if (key == "seed") settings.seed = (unsigned long long)json.to_int();
+		else if (key == "step") settings.step = (unsigned)json.to_int();
+		else if (key == "speed") settings.speed = json.to_double();
+		else if (key == "max_interval") settings.max_interval = (unsigned)json.to_int();
+		else if (key == "price") settings.price = json.to_double();
+		else if (key == "volatility") settings.volatility = json.to_double();
+		else if (key == "drift") settings.drift = json.to_double();
+		else if (key == "garch_alpha") settings.garch_alpha = json.to_double();
+		else if (key == "garch_beta") settings.garch_beta = json.to_double();
+		else if (key == "regime_switch") settings.regime_switch = json.to_double();
+		else if (key == "regime_volatility") settings.regime_volatility = json.to_double();
+		else if (key == "gap_chance") settings.gap_chance = json.to_double();
+		else if (key == "gap_size") settings.gap_size = json.to_double();
+		else if (key == "spread") settings.spread = json.to_double();
+		else if (key == "slippage") settings.slippage = json.to_double();
+		else if (key == "latency") settings.latency = (unsigned)json.to_int();
+		else if (key == "balance") settings.balance = json.to_double();
+		else if (key == "leverage") settings.leverage = (unsigned)json.to_int();
+		else return "unknown setting";
+	}
+
+	if (token != JSON_OBJECT_END) return "settings failed to parse";
+
+	// every served interval has to be made of whole base candles
+	if (settings.step == 0) return "step must be greater than zero";
+	if (settings.max_interval < settings.step || settings.max_interval % settings.step != 0)
+	{
+		return "max_interval must be a multiple of step";
+	}
+
+	return NULL;
+}
+
+const char *init(const char** credentials)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	std::string filepath = credentials[0];
+
+	settings = Settings();
+	if (!filepath.empty())
+	{
+		std::ifstream file(filepath);
+		if (!file) return "failed to open simulator settings";
+
+		std::stringstream ss;
+		ss << file.rdbuf();
+
+		const char *error = read_settings(ss.str());
+		if (error) return error;
+	}
+
+	if (settings.speed <= 0.0) return "speed must be greater than zero";
+	if (settings.leverage == 0) return "leverage of 0 is not allowed";
+
+	model = market_model();
+	const char *error = check_market_model(model);
+	if (error) return error;
+
+	// the most recent interval candle can end up to one interval before the
+	// last base candle, hence the extra one
+	history = (long long)(MAX_CANDLES + 1) * (settings.max_interval / settings.step);
+	balance = settings.balance;
+	instruments.clear();
+	slippage_rng.seed(settings.seed);
+	real_start = std::chrono::steady_clock::now();
+	sim_start = (double)std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	return NULL;
+}
+
+const char *get_price_history(PriceHistory* out, const char *ticker)
+{
+	PriceHistory& hist = *out;
+	if (!to_interval(hist.interval())) return "interval given is not valid";
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	unsigned per_candle = hist.interval() / settings.step;
+	Instrument& inst = get_instrument(ticker);
+
+	// the last interval candle ends at the most recent interval boundary
+	long long end = ((inst.last + 1) / per_candle) * per_candle;
+	long long begin = end - (long long)hist.size() * per_candle;
+	long long first = inst.last - (long long)inst.candles.size() + 1;
+
+	if (begin < first) return "requested more history than the simulator retains";
+
+	size_t offset = begin - first;
+	for (unsigned i = 0; i < hist.size(); ++i)
+	{
+		const Candle& open = inst.candles[offset];
+		double high = open.high();
+		double low = open.low();
+		double close = open.close();
+		double volume = 0.0;
+
+		for (unsigned j = 0; j < per_candle; ++j)
+		{
+			const Candle& c = inst.candles[offset + j];
+			if (c.high() > high) high = c.high();
+			if (c.low() < low) low = c.low();
+			close = c.close();
+			volume += c.volume();
+		}
+
+		hist.get(i) = { open.open(), high, low, close, volume };
+		offset += per_candle;
+	}
+
+	return NULL;
+}
+
+/**
+ * Marks every position and sums up the account. Must be called with the
+ * mutex locked.
+ */
+Account account_info()
+{
+	// positions are marked at their last generated close
+	double unrealized = 0.0;
+	double margin_used = 0.0;
+	for (const auto& pair : instruments)
+	{
+		const Instrument& inst = pair.second;
+		if (inst.shares == 0.0) continue;
+
+		double price = inst.close;
+		unrealized += inst.shares * (price - inst.avg_price);
+		margin_used += std::abs(inst.shares) * price / (double)settings.leverage;
+	}
+
+	double equity = balance + unrealized;
+	double margin_available = equity - margin_used;
+	if (margin_available < 0.0) margin_available = 0.0;
+
+	return
+	{
+		balance,
+		margin_available * (double)settings.leverage,
+		margin_used,
+		equity,
+		(int)settings.leverage,
+		true
+	};
+}
+
+const char *get_account(Account *out)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	*out = account_info();
+	return NULL;
+}
+
+const char *market_order(Fill* out, const char *ticker, double amount)
+{
+	if (settings.latency > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(settings.latency));
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Instrument& inst = get_instrument(ticker);
+	double mid = inst.close;
+
+	// buys fill above mid and sells below it
+	double direction = (amount > 0.0) ? 1.0 : -1.0;
+	double slippage = settings.slippage * std::uniform_real_distribution<double>()(slippage_rng);
+	double price = mid * (1.0 + direction * (settings.spread / 2.0 + slippage));
+
+	// checking if there is enough margin for the part of the order that opens a position
+	double opening = (inst.shares * amount >= 0.0) ? std::abs(amount)
+		: std::max(0.0, std::abs(amount) - std::abs(inst.shares));
+	if (opening * price > account_info().buying_power())
+	{
+		return "insufficient margin for order";
+	}
+
+	if (inst.shares * amount >= 0.0)
+	{
+		// adding to or opening a position
+		double total = std::abs(inst.shares) + std::abs(amount);
+		inst.avg_price = (inst.avg_price * std::abs(inst.shares) + price * std::abs(amount)) / total;
+		inst.shares += amount;
+	}
+	else
+	{
+		// reducing, closing or flipping a position
+		double closed = std::min(std::abs(amount), std::abs(inst.shares));
+		double side = (inst.shares > 0.0) ? 1.0 : -1.0;
+		balance += closed * (price - inst.avg_price) * side;
+		inst.shares += amount;
+
+		if (inst.shares == 0.0) inst.avg_price = 0.0;
+		else if (inst.shares * side < 0.0) inst.avg_price = price;
+	}
+
+	// the fee is what was paid over mid
+	*out = { amount, price, std::abs(amount) * std::abs(price - mid) };
+
+	return NULL;
+}
+
+const char *get_position(Position* out, const char *ticker)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Instrument& inst = get_instrument(ticker);
+	double price = inst.close;
+
+	*out =
+	{
+		std::abs(inst.shares) * inst.avg_price,
+		settings.spread / 2.0,
+		1.0,
+		price,
+		inst.shares
+	};
+
+	return NULL;
+}
+
+const char *get_quote(double *price, double *spread, const char *ticker)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Instrument& inst = get_instrument(ticker);
+	*price = inst.close;
+	*spread = inst.close * settings.spread;
+
+	return NULL;
+}
+
+const char *set_leverage(uint32_t multiplier)
+{
+	if (multiplier == 0) return "leverage of 0 is not allowed";
+	std::lock_guard<std::mutex> lock(mtx);
+	settings.leverage = multiplier;
+	return NULL;
+}
+
+uint32_t secs_till_market_close()
+{
+	// the simulated market never closes
+	return WEEK;
+}
+
+const char* to_interval(uint32_t interval)
+{
+	if (settings.step == 0 || interval % settings.step != 0) return nullptr;
+	if (interval > settings.max_interval) return nullptr;
+
+	switch(interval)
+	{
+	case SEC5:		return "S5";
+	case SEC10:		return "S10";
+	case SEC15:		return "S15";
+	case SEC30:		return "S30";
+	case MIN1:		return "M1";
+	case MIN2:		return "M2";
+	case MIN4:		return "M4";
+	case MIN5:		return "M5";
+	case MIN10:		return "M10";
+	case MIN15:		return "M15";
+	case MIN30:		return "M30";
+	case HOUR1:		return "H1";
+	case HOUR2:		return "H2";
+	case HOUR3:		return "H3";
+	case HOUR4:		return "H4";
+	case HOUR6:		return "H6";
+	case HOUR8:		return "H8";
+	case HOUR12:	return "H12";
+	case DAY:		return "D";
+	default:		return nullptr;
+	}
+}
@@ -1,5 +1,6 @@
 #define DATA_LENGTH 5
 #define LABEL "Simple MA"
+#define REENTRANT 1
 
 #include <api/strategy_api.h>
 
@@ -2,13 +2,21 @@
 #define DAYTRENDER_CLIENT_H
 
 // daytrender includes
+#include <api/ordermanager.h>
+#include <api/scheduler.h>
+#include <api/spreadestimator.h>
 #include <data/asset.h>
 #include <data/account.h>
+#include <data/fill.h>
 #include <data/pricehistory.h>
 #include <data/position.h>
 #include <data/result.h>
+#include <util/executor.h>
+#include <util/latency.h>
 
 // standard library
+#include <functional>
+#include <future>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -20,14 +28,25 @@
 
 #define cli_func_check() if (!_plugin) return "client is not bound"
 
+// threads per plugin that wait on broker requests for async calls
+#define CLIENT_IO_THREADS 4
+
 namespace daytrender
 {
 	class Client
 	{
 	private:
 		static std::unordered_map<std::string, std::shared_ptr<hirzel::Plugin>> _plugins;
+		static std::unordered_map<std::string, std::shared_ptr<RequestScheduler>> _schedulers;
+		static std::unordered_map<std::string, std::shared_ptr<SpreadEstimator>> _spreads;
+		static std::unordered_map<std::string, std::shared_ptr<Executor>> _executors;
+		static std::unordered_map<std::string, std::shared_ptr<OrderManager>> _order_managers;
 
 		std::shared_ptr<hirzel::Plugin> _plugin;
+		std::shared_ptr<RequestScheduler> _scheduler;
+		std::shared_ptr<SpreadEstimator> _spread;
+		std::shared_ptr<Executor> _io;
+		std::shared_ptr<OrderManager> _orders;
 		std::string _filename;
 		
 		// init func
@@ -36,11 +55,12 @@ namespace daytrender
 
 		// api functions
 		
-		const char *(*_market_order)(const char*, double) = nullptr;
+		const char *(*_market_order)(Fill*, const char*, double) = nullptr;
 		const char *(*_set_leverage)(uint32_t) = nullptr;
 		const char *(*_get_account)(Account*) = nullptr;
 		const char *(*_get_price_history)(PriceHistory*, const char*) = nullptr;
 		const char *(*_get_position)(Position*, const char*) = nullptr;
+		const char *(*_get_quote)(double*, double*, const char*) = nullptr;
 		const char *(*_to_interval)(uint32_t) = nullptr;
 		uint32_t(*_secs_till_market_close)() = nullptr;
 
@@ -49,7 +69,10 @@ namespace daytrender
 		uint32_t (*_key_count)() = nullptr;
 		uint32_t (*_max_candles)() = nullptr;
 		uint32_t (*_api_version)() = nullptr;
+		uint32_t (*_rate_limit)() = nullptr;
+		uint32_t (*_rate_burst)() = nullptr;
 
+		bool quote(const std::string& ticker, double& price, double& fee) const;
 
 	public:
 		Client() = default;
@@ -62,28 +85,69 @@ namespace daytrender
 		const char *init(const hirzel::Data& keys);
 
 		// non returning
-		const char *market_order(const std::string& ticker, double amount);
+		Result<Fill> market_order(const std::string& ticker, double amount,
+			RequestPriority priority = PRIORITY_ORDER);
 		const char *set_leverage(unsigned leverage);
 
 		// returning
-		Result<Account> get_account() const;
+		Result<Account> get_account(RequestPriority priority = PRIORITY_POSITION) const;
 
 		Result<PriceHistory> get_price_history(const std::string& ticker,
 			unsigned interval, unsigned count) const;
 
-		Result<Position> get_position(const std::string& ticker) const;
+		Result<Position> get_position(const std::string& ticker,
+			RequestPriority priority = PRIORITY_POSITION) const;
 
 		const char *to_interval(int interval) const;
 
+		// asynchronous versions that run on the plugin's io threads
+
+		std::future<Result<Account>> get_account_async(
+			RequestPriority priority = PRIORITY_POSITION) const;
+
+		/**
+		 * @param	latency	optional histogram that the duration of the request
+		 *					is recorded in, not counting time spent queued
+		 */
+		std::future<Result<PriceHistory>> get_price_history_async(const Asset& asset,
+			LatencyHistogram *latency = nullptr) const;
+
+		std::future<Result<Position>> get_position_async(const std::string& ticker,
+			RequestPriority priority = PRIORITY_POSITION) const;
+
+		std::future<Result<Fill>> market_order_async(const std::string& ticker, double amount,
+			RequestPriority priority = PRIORITY_ORDER);
+
 		// derivative functions
 		inline Result<PriceHistory> get_price_history(const Asset& asset) const
 		{
 			return get_price_history(asset.ticker(), asset.interval(), asset.candle_count());
 		}
 
+		/**
+		 * Sizes an order for entering a position without placing it.
+		 *
+		 * @param	limit	optional function that receives the desired shares
+		 *					and the current price and returns how many of the
+		 *					shares may be ordered
+		 * @return			signed shares to order, rounded to the order minimum
+		 */
+		Result<double> shares_to_enter(const Asset& asset, double pct, bool short_shares,
+			const std::function<double(double, double)>& limit = nullptr) const;
+
+		/**
+		 * Sizes the position an asset should hold after entering it, given
+		 * account and position information that was already fetched.
+		 *
+		 * @return	signed shares to hold, not rounded to the order minimum
+		 */
+		double target_shares(const Asset& asset, double pct, bool short_shares,
+			const Account& acc, const Position& pos) const;
+
 		const char *enter_position(const Asset& asset, double pct, bool short_shares);
 		const char *exit_position(const Asset& asset, bool short_shares);
-		const char *close_position(const Asset& asset);
+		const char *close_position(const Asset& asset,
+			RequestPriority priority = PRIORITY_CLOSEOUT);
 		const char *close_all_positions(const std::vector<Asset>& assets);
 
 		inline const char *enter_long(const Asset& asset, double pct)
@@ -111,9 +175,16 @@ namespace daytrender
 			return _secs_till_market_close();
 		}
 
+		// quotes the ticker in the background so its positions have a fee
+		inline void track_spread(const std::string& ticker)
+		{
+			if (_spread) _spread->track(ticker);
+		}
+
 		// inline getter functions
 		inline bool is_bound() const { return (bool)_plugin; }
 		inline const std::string& filename() const { return _filename; }
+		inline const OrderManager *orders() const { return _orders.get(); }
 	};
 }
 
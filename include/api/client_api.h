@@ -11,10 +11,21 @@
 #error KEY_COUNT must be defined!
 #endif
 
+// requests per second allowed by the broker, 0 if there is no limit
+#ifndef RATE_LIMIT
+#define RATE_LIMIT 0
+#endif
+
+// requests that can be sent at once before the rate limit applies
+#ifndef RATE_BURST
+#define RATE_BURST RATE_LIMIT
+#endif
+
 // local includes
 #include <api/versions.h>
 #include <api/interval.h>
 #include <data/account.h>
+#include <data/fill.h>
 #include <data/pricehistory.h>
 #include <data/position.h>
 
@@ -59,7 +70,7 @@ extern "C"
 
 	// non returning functions
 	const char *init(const char** credentials);
-	const char *market_order(const char* ticker, double amount);
+	const char *market_order(Fill* out, const char* ticker, double amount);
 	const char *set_leverage(uint32_t multiplier);
 
 	// returning functions
@@ -67,12 +78,15 @@ extern "C"
 	const char *to_interval(uint32_t interval);
 	const char *get_price_history(PriceHistory* out, const char *ticker);
 	const char *get_position(Position* out, const char* ticker);
+	const char *get_quote(double* price, double* spread, const char* ticker);
 	const char *get_account(Account* out);
 
 	// pre-defined functions
 	uint32_t key_count() { return KEY_COUNT; }
 	uint32_t max_candles() { return MAX_CANDLES; }
 	uint32_t api_version() { return CLIENT_API_VERSION; }
+	uint32_t rate_limit() { return RATE_LIMIT; }
+	uint32_t rate_burst() { return RATE_BURST; }
 
 	// used for freeing buffer from main executable
 	void free_buffer(char* buffer) { delete buffer; }
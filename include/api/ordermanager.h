@@ -0,0 +1,119 @@
+#ifndef DAYTRENDER_ORDERMANAGER_H
+#define DAYTRENDER_ORDERMANAGER_H
+
+// local includes
+#include <data/fill.h>
+
+// standard library
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// seconds the local position of an instrument is trusted before asking the broker
+#define ORDER_RECONCILE_INTERVAL 60
+// finished orders kept for inspection
+#define ORDER_HISTORY_SIZE 256
+
+namespace daytrender
+{
+	enum OrderStatus
+	{
+		ORDER_PENDING,
+		ORDER_FILLED,
+		ORDER_REJECTED
+	};
+
+	struct Order
+	{
+		unsigned long long id;
+		std::string ticker;
+		// signed shares requested
+		double shares;
+		OrderStatus status;
+		Fill fill;
+		// reason for rejection
+		const char *error;
+		// epoch seconds
+		long long sent;
+	};
+
+	/**
+	 * Position of one instrument as known from fills
+	 */
+	struct BookPosition
+	{
+		double shares = 0.0;
+		double avg_price = 0.0;
+		// fees paid since the last reconciliation
+		double fees = 0.0;
+		double minimum = 1.0;
+		// epoch seconds of the last reconciliation, 0 if the book can't be trusted
+		long long reconciled = 0;
+		unsigned pending = 0;
+		// incremented with every order so stale broker reads can be detected
+		unsigned long long version = 0;
+	};
+
+	/**
+	 * Tracks the orders sent through one client plugin and keeps a local
+	 * position book from their fills. Positions are read from the book and
+	 * only reconciled with the broker every ORDER_RECONCILE_INTERVAL, after
+	 * a rejection or while an order is in flight.
+	 */
+	class OrderManager
+	{
+	private:
+		mutable std::mutex _mtx;
+		std::unordered_map<std::string, BookPosition> _book;
+		std::deque<Order> _orders;
+		unsigned long long _next_id = 1;
+
+		Order *find(unsigned long long id);
+
+	public:
+		/**
+		 * Records an order that is about to be sent.
+		 *
+		 * @return	id of the order
+		 */
+		unsigned long long submit(const std::string& ticker, double shares);
+
+		/**
+		 * Marks an order as filled and applies the fill to the book.
+		 */
+		void fill(unsigned long long id, const Fill& fill);
+
+		/**
+		 * Marks an order as rejected. The broker may have acted on it anyway,
+		 * so the position has to be reconciled before it is trusted again.
+		 */
+		void reject(unsigned long long id, const char *error);
+
+		/**
+		 * @param	out	position from the book
+		 * @return		false if the position has to be fetched from the broker
+		 */
+		bool position(const std::string& ticker, BookPosition& out) const;
+
+		/**
+		 * @return	version of the position, to be taken before asking the broker
+		 */
+		unsigned long long version(const std::string& ticker) const;
+
+		/**
+		 * Replaces the book's position with the one reported by the broker
+		 * unless an order was sent since the version was taken.
+		 */
+		void reconcile(const std::string& ticker, double shares, double avg_price,
+			double minimum, unsigned long long version);
+
+		/**
+		 * @return	copy of the most recent orders, oldest first
+		 */
+		std::vector<Order> orders() const;
+	};
+}
+
+#endif
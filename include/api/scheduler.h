@@ -0,0 +1,150 @@
+#ifndef DAYTRENDER_SCHEDULER_H
+#define DAYTRENDER_SCHEDULER_H
+
+// local includes
+#include <data/result.h>
+
+// standard library
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace daytrender
+{
+	/**
+	 * Priority classes for broker requests, from most to least urgent.
+	 */
+	enum RequestPriority
+	{
+		PRIORITY_CLOSEOUT,
+		PRIORITY_ORDER,
+		PRIORITY_POSITION,
+		PRIORITY_HISTORY,
+		PRIORITY_COUNT
+	};
+
+	/**
+	 * Schedules the requests made through one client plugin. Requests are
+	 * admitted through a token bucket sized from the limits the plugin
+	 * declares, always in priority order, and history requests may not use
+	 * the last quarter of the bucket so orders never wait behind them.
+	 *
+	 * Identical requests that are already in flight are coalesced so that
+	 * every caller shares one response.
+	 */
+	class RequestScheduler
+	{
+	private:
+		struct InFlight
+		{
+			bool sent = false;
+			bool done = false;
+			unsigned waiters = 0;
+			unsigned long long generation = 0;
+			const char *error = nullptr;
+			std::shared_ptr<void> value;
+		};
+
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		double _rate = 0.0;
+		double _burst = 0.0;
+		double _reserve = 0.0;
+		double _tokens = 0.0;
+		std::chrono::steady_clock::time_point _last_refill;
+		unsigned _waiting[PRIORITY_COUNT] = { 0 };
+		unsigned long long _generation = 0;
+		std::unordered_map<std::string, std::shared_ptr<InFlight>> _in_flight;
+
+		void refill();
+
+	public:
+		/**
+		 * @param	rate	requests allowed per second, 0 for no limit
+		 * @param	burst	requests that can be made at once
+		 */
+		RequestScheduler(unsigned rate, unsigned burst);
+
+		/**
+		 * Blocks until a request of the given priority may be sent.
+		 */
+		void acquire(RequestPriority priority);
+
+		/**
+		 * Marks every request currently in flight as stale so that requests
+		 * made after an order don't share a response from before it.
+		 */
+		void invalidate();
+
+		/**
+		 * Sends a request or, if an identical one is already in flight,
+		 * waits for its response instead.
+		 *
+		 * @param	key			identifies identical requests
+		 * @param	priority	priority to send the request with
+		 * @param	request		callable returning Result<T>
+		 */
+		template <typename T, typename Request>
+		Result<T> coalesce(const std::string& key, RequestPriority priority, Request&& request)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+
+			// only requests that were already sent are joined so that an urgent
+			// caller never waits for a lower priority request to be admitted
+			auto iter = _in_flight.find(key);
+			if (iter != _in_flight.end() && iter->second->sent
+				&& iter->second->generation == _generation)
+			{
+				std::shared_ptr<InFlight> flight = iter->second;
+				flight->waiters += 1;
+				_cv.wait(lock, [&]() { return flight->done; });
+
+				if (flight->error) return flight->error;
+				T copy = *std::static_pointer_cast<T>(flight->value);
+				return copy;
+			}
+
+			std::shared_ptr<InFlight> flight = std::make_shared<InFlight>();
+			flight->generation = _generation;
+			_in_flight[key] = flight;
+			lock.unlock();
+
+			acquire(priority);
+
+			lock.lock();
+			flight->sent = true;
+			lock.unlock();
+
+			Result<T> res = request();
+
+			lock.lock();
+			iter = _in_flight.find(key);
+			if (iter != _in_flight.end() && iter->second == flight) _in_flight.erase(iter);
+			flight->done = true;
+
+			// the value only needs to be shared if someone is waiting on it
+			if (flight->waiters == 0) return res;
+
+			if (!res)
+			{
+				flight->error = res.error();
+				lock.unlock();
+				_cv.notify_all();
+				return res;
+			}
+
+			std::shared_ptr<T> value = std::make_shared<T>(res.get());
+			flight->value = value;
+			lock.unlock();
+			_cv.notify_all();
+
+			T copy = *value;
+			return copy;
+		}
+	};
+}
+
+#endif
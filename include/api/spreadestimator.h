@@ -0,0 +1,82 @@
+#ifndef DAYTRENDER_SPREADESTIMATOR_H
+#define DAYTRENDER_SPREADESTIMATOR_H
+
+// standard library
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// seconds between background refreshes of each instrument
+#define SPREAD_REFRESH_INTERVAL 5
+// estimates older than this many seconds aren't used, as their quotes keep failing
+#define SPREAD_MAX_AGE 30
+// weight of the newest quote in the moving average
+#define SPREAD_EWMA_ALPHA 0.2
+
+namespace daytrender
+{
+	/**
+	 * Keeps an exponentially weighted estimate of the half-spread fee of
+	 * every instrument that has been asked for, refreshed in the
+	 * background from the client's quotes so that position queries don't
+	 * have to compute it.
+	 */
+	class SpreadEstimator
+	{
+	public:
+		// gets the mid price and full spread of a ticker
+		typedef std::function<const char *(double*, double*, const char*)> QuoteFunction;
+
+	private:
+		struct Estimate
+		{
+			double fee = 0.0;
+			double price = 0.0;
+			long long updated = 0;
+		};
+
+		QuoteFunction _quote;
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		std::unordered_map<std::string, Estimate> _estimates;
+		std::thread _thread;
+		bool _running = false;
+
+		const char *update(const std::string& ticker);
+		void refresh();
+		// must be called with the mutex locked
+		void start();
+
+	public:
+		SpreadEstimator(QuoteFunction quote);
+		~SpreadEstimator();
+
+		/**
+		 * Gets the estimated fee as a ratio of price and the last mid price
+		 * of the ticker without waiting for a quote. A ticker that hasn't been
+		 * asked for before is quoted in the background from then on.
+		 *
+		 * @return	false if there is no usable estimate yet, in which case
+		 *			price and fee are 0
+		 */
+		bool get(const std::string& ticker, double& price, double& fee);
+
+		/**
+		 * Starts quoting a ticker in the background, so that it has an
+		 * estimate by the time it is first asked for.
+		 */
+		void track(const std::string& ticker);
+
+		/**
+		 * Adds a quote that was fetched elsewhere to the estimate.
+		 *
+		 * @return	estimated fee as a ratio of price, including the quote
+		 */
+		double record(const std::string& ticker, double price, double spread);
+	};
+}
+
+#endif
@@ -6,10 +6,12 @@
 #include <data/result.h>
 
 // standard library
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 
 // external libraries
 #include <hirzel/plugin.h>
@@ -20,6 +22,7 @@ namespace daytrender
 	{
 	private:
 		static std::unordered_map<std::string, std::shared_ptr<hirzel::Plugin>> _plugins;
+		static std::unordered_map<std::string, std::shared_ptr<std::mutex>> _locks;
 
 		// plugin info
 		std::string _filename;
@@ -28,6 +31,10 @@ namespace daytrender
 		int _indicator_count = 0;
 		int _data_length = 0;
 		const char *(*_execute)(Chart*) = nullptr;
+		// optional, only used for profiling
+		const char *(*_execute_indicator)(Chart*, uint32_t) = nullptr;
+		// serializes calls into plugins that are not reentrant, null otherwise
+		std::shared_ptr<std::mutex> _lock = nullptr;
 
 	public:
 		Strategy() = default;
@@ -35,11 +42,20 @@ namespace daytrender
 
 		Chart execute(const PriceHistory& candles,
 			const std::vector<int>& ranges) const;
+
+		/**
+		 * Calculates a single indicator of a chart made for this strategy.
+		 *
+		 * @return	an error message or nullptr on success
+		 */
+		const char *execute_indicator(Chart& chart, unsigned index) const;
 			
 		inline const std::string& filename() const { return _filename; };
 		inline int indicator_count() const { return _indicator_count; }
 		inline bool is_bound() const { return (bool)_plugin; }
 		inline int data_length() const { return _data_length; }
+		inline bool is_reentrant() const { return !_lock; }
+		inline bool has_execute_indicator() const { return _execute_indicator != nullptr; }
 	};
 }
 
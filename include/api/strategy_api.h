@@ -16,6 +16,12 @@
 #error DATA_LENGTH must be defined
 #endif
 
+// set to 1 if execute may run on several threads at once. Strategies that
+// keep global state besides the constant config should leave it at 0.
+#ifndef REENTRANT
+#define REENTRANT 0
+#endif
+
 using namespace daytrender;
 
 #include <stdint.h>
@@ -41,6 +47,7 @@ extern "C"
 
 	uint32_t data_length() { return DATA_LENGTH; }
 	uint32_t api_version() { return STRATEGY_API_VERSION; }
+	uint32_t is_reentrant() { return REENTRANT; }
 
 	// user defined functions
 	const char *execute(Chart* out)
@@ -65,6 +72,26 @@ extern "C"
 
 		return NULL;
 	}
+
+	// runs a single indicator so tools can time them one by one
+	const char *execute_indicator(Chart* out, uint32_t index)
+	{
+		Chart &chart = *out;
+
+		if (index >= config.size())
+			return "indicator index is out of range";
+
+		if (chart.candles().empty())
+			return "no candles were passed to strategy";
+
+		if (chart.ranges().size() != indicator_count())
+			return "strategy dataset size did not match expected sizse";
+
+		chart[index].set_ident(config[index].type, config[index].label);
+		config[index].func(chart[index], chart.candles(), chart.ranges()[index]);
+
+		return NULL;
+	}
 	// pre-defined functions
 }
 
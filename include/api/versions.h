@@ -1,7 +1,7 @@
 #ifndef DAYTRENDER_API_VERSIONS_H
 #define DAYTRENDER_API_VERSIONS_H
 
-#define CLIENT_API_VERSION		1
-#define STRATEGY_API_VERSION	1
+#define CLIENT_API_VERSION		4
+#define STRATEGY_API_VERSION	2
 
 #endif
@@ -44,6 +44,16 @@ namespace daytrender
 			return hirzel::sys::epoch_seconds() - _last_update >= _interval;
 		}
 
+		/**
+		 * @param	now	current time in epoch milliseconds
+		 * @return		epoch milliseconds at which the current candle closes
+		 */
+		inline long long next_close(long long now) const
+		{
+			long long interval = (long long)_interval * 1000;
+			return (now / interval + 1) * interval;
+		}
+
 		// inline getter functions
 		inline const Chart& data() const { return _data; }
 		inline const Strategy& strategy() const { return _strategy; }
@@ -18,7 +18,13 @@ namespace daytrender
 
 	public:
 		Candle() = default;
-		Candle(double open, double high, double low, double close, double volume);
+		Candle(double open, double high, double low, double close, double volume) :
+		_open(open),
+		_high(high),
+		_low(low),
+		_close(close),
+		_volume(volume)
+		{}
 
 		inline double o() const { return _open; }
 		inline double open() const { return _open; }
@@ -0,0 +1,191 @@
+#ifndef DAYTRENDER_EQUITYHISTORY_H
+#define DAYTRENDER_EQUITYHISTORY_H
+
+// standard library
+#include <cstddef>
+#include <vector>
+
+namespace daytrender
+{
+	struct EquitySample
+	{
+		// epoch seconds
+		long long time;
+		double equity;
+	};
+
+	/**
+	 * Samples held by an EquityHistory in chronological order. The ring may
+	 * wrap, so they are split over at most two contiguous arrays.
+	 */
+	struct EquitySegments
+	{
+		const EquitySample *first;
+		size_t first_size;
+		const EquitySample *second;
+		size_t second_size;
+
+		inline size_t size() const { return first_size + second_size; }
+	};
+
+	/**
+	 * Equity samples over a rolling time window, kept in a ring. The
+	 * highest and lowest equity in the window are tracked with monotonic
+	 * queues, so every query and each push are amortized O(1). Nothing is
+	 * allocated after construction unless more samples arrive within the
+	 * window than the ring holds, in which case it doubles.
+	 */
+	class EquityHistory
+	{
+	private:
+		// fixed ring of sequence numbers, used as a double ended queue
+		struct IndexQueue
+		{
+			std::vector<size_t> data;
+			size_t head = 0;
+			size_t tail = 0;
+
+			inline bool empty() const { return head == tail; }
+		};
+
+		// sized on construction so pushing only allocates when the ring grows
+		std::vector<EquitySample> _samples;
+		size_t _capacity = 0;
+		long long _window = 0;
+		// sequence number of the oldest sample and of the next one pushed
+		size_t _begin = 0;
+		size_t _end = 0;
+		// sequence numbers of samples that could still become the maximum
+		// or minimum of the window, oldest first
+		IndexQueue _peaks;
+		IndexQueue _troughs;
+
+		inline const EquitySample& at(size_t seq) const { return _samples[seq % _capacity]; }
+
+		inline size_t& slot(IndexQueue& queue, size_t pos)
+		{
+			return queue.data[pos % _capacity];
+		}
+
+		inline size_t front(const IndexQueue& queue) const
+		{
+			return queue.data[queue.head % _capacity];
+		}
+
+		inline size_t back(const IndexQueue& queue) const
+		{
+			return queue.data[(queue.tail - 1) % _capacity];
+		}
+
+		void pop_front()
+		{
+			if (!_peaks.empty() && front(_peaks) == _begin) _peaks.head += 1;
+			if (!_troughs.empty() && front(_troughs) == _begin) _troughs.head += 1;
+			_begin += 1;
+		}
+
+		// doubles the ring, keeping every sample at its sequence number
+		void grow()
+		{
+			size_t capacity = _capacity * 2;
+
+			std::vector<EquitySample> samples(capacity);
+			for (size_t seq = _begin; seq < _end; ++seq) samples[seq % capacity] = at(seq);
+
+			for (IndexQueue *queue : { &_peaks, &_troughs })
+			{
+				std::vector<size_t> data(capacity);
+				for (size_t pos = queue->head; pos < queue->tail; ++pos)
+				{
+					data[pos % capacity] = queue->data[pos % _capacity];
+				}
+				queue->data.swap(data);
+			}
+
+			_samples.swap(samples);
+			_capacity = capacity;
+		}
+
+	public:
+		EquityHistory() : EquityHistory(1, 0) {}
+
+		/**
+		 * @param	capacity	samples held before the ring has to grow
+		 * @param	window		seconds that samples are kept for
+		 */
+		EquityHistory(size_t capacity, long long window) :
+		_samples(capacity ? capacity : 1),
+		_capacity(capacity ? capacity : 1),
+		_window(window)
+		{
+			_peaks.data.resize(_capacity);
+			_troughs.data.resize(_capacity);
+		}
+
+		/**
+		 * Adds a sample and drops those that are older than the window
+		 * relative to it.
+		 */
+		void push(long long time, double equity)
+		{
+			if (_end - _begin == _capacity)
+			{
+				// samples still in the window are never dropped early
+				if (time - front().time > _window) pop_front();
+				else grow();
+			}
+
+			_samples[_end % _capacity] = { time, equity };
+
+			while (!_peaks.empty() && at(back(_peaks)).equity <= equity) _peaks.tail -= 1;
+			slot(_peaks, _peaks.tail++) = _end;
+
+			while (!_troughs.empty() && at(back(_troughs)).equity >= equity) _troughs.tail -= 1;
+			slot(_troughs, _troughs.tail++) = _end;
+
+			_end += 1;
+
+			while (time - at(_begin).time > _window) pop_front();
+		}
+
+		void clear()
+		{
+			_begin = _end = 0;
+			_peaks.head = _peaks.tail = 0;
+			_troughs.head = _troughs.tail = 0;
+		}
+
+		inline bool empty() const { return _begin == _end; }
+		inline size_t size() const { return _end - _begin; }
+		inline size_t capacity() const { return _capacity; }
+		inline long long window() const { return _window; }
+
+		// oldest and newest samples, only valid if not empty
+		inline const EquitySample& front() const { return at(_begin); }
+		inline const EquitySample& back() const { return at(_end - 1); }
+
+		// highest and lowest equity in the window
+		inline double peak() const { return at(front(_peaks)).equity; }
+		inline double trough() const { return at(front(_troughs)).equity; }
+
+		// change in equity over the window
+		inline double pl() const { return back().equity - front().equity; }
+
+		// how far the latest equity is below the highest in the window
+		inline double drawdown() const { return peak() - back().equity; }
+
+		/**
+		 * @return	the samples in chronological order without copying them
+		 */
+		EquitySegments segments() const
+		{
+			size_t start = _begin % _capacity;
+			size_t count = size();
+			size_t first = count < _capacity - start ? count : _capacity - start;
+
+			return { &_samples[start], first, &_samples[0], count - first };
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef DAYTRENDER_EVENTQUEUE_H
+#define DAYTRENDER_EVENTQUEUE_H
+
+// standard library
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace daytrender
+{
+	struct Event
+	{
+		// special values for asset
+		static constexpr int PORTFOLIO = -1;
+		static constexpr int WATCHDOG = -2;
+
+		// epoch milliseconds at which the event is due
+		long long time;
+		unsigned portfolio;
+		// index of the asset to update, PORTFOLIO to update the portfolio
+		// itself or WATCHDOG to check on the workers
+		int asset;
+
+		inline bool operator>(const Event& other) const
+		{
+			if (time != other.time) return time > other.time;
+			if (portfolio != other.portfolio) return portfolio > other.portfolio;
+			return asset > other.asset;
+		}
+	};
+
+	/**
+	 * Min-heap of timed events. A single thread waits for the earliest
+	 * event to come due while others can push events or stop it.
+	 */
+	class EventQueue
+	{
+	private:
+		std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _events;
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		bool _stopped = false;
+		// microseconds before an event is due that the waiting thread spins
+		long long _spin = 0;
+
+	public:
+		static long long epoch_millis();
+		static long long epoch_micros();
+
+		/**
+		 * Makes the waiting thread stop sleeping the given number of
+		 * microseconds before an event is due and poll for the rest. This
+		 * trades CPU time for less wakeup jitter.
+		 */
+		void set_spin(long long micros);
+
+		void push(const Event& event);
+
+		/**
+		 * Blocks until the earliest event is due and pops it.
+		 *
+		 * @return	false if the queue was stopped while waiting
+		 */
+		bool wait(Event& out);
+
+		/**
+		 * Wakes up the waiting thread immediately and makes every following
+		 * wait return false.
+		 */
+		void stop();
+
+		void clear();
+	};
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef DAYTRENDER_FILL_H
+#define DAYTRENDER_FILL_H
+
+namespace daytrender
+{
+	/**
+	 * Result of an order as reported by the broker
+	 */
+	class Fill
+	{
+	private:
+		// signed shares that were filled, negative for sells
+		double _shares = 0.0;
+		// average price of the fill
+		double _price = 0.0;
+		// commission and spread paid in account currency
+		double _fee = 0.0;
+
+	public:
+		Fill() = default;
+		Fill(double shares, double price, double fee);
+
+		inline double shares() const { return _shares; }
+		inline double price() const { return _price; }
+		inline double fee() const { return _fee; }
+		inline bool empty() const { return _shares == 0.0; }
+	};
+}
+
+#endif
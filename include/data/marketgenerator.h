@@ -0,0 +1,159 @@
+#ifndef DAYTRENDER_MARKETGENERATOR_H
+#define DAYTRENDER_MARKETGENERATOR_H
+
+// local includes
+#include <data/pricehistory.h>
+
+// standard library
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// independent generators interleaved so bulk draws can use vector instructions
+#define RANDOM_LANES 4
+// candles generated per asset at a time so random numbers are drawn in bulk
+#define MARKET_BLOCK_SIZE 512
+
+namespace daytrender
+{
+	/**
+	 * xoshiro256** generators run side by side. The same seed always gives
+	 * the same sequence on every platform.
+	 */
+	class RandomStream
+	{
+	private:
+		uint64_t _state[4][RANDOM_LANES];
+
+	public:
+		RandomStream(uint64_t seed = 1);
+
+		/**
+		 * Fills out with uniform numbers in (0, 1), never exactly 0 or 1.
+		 */
+		void fill_uniform(double *out, size_t count);
+
+		/**
+		 * Fills out with standard normal numbers.
+		 *
+		 * @param	scratch	space for count numbers
+		 */
+		void fill_normal(double *out, double *scratch, size_t count);
+	};
+
+	/**
+	 * @param	p	probability in (0, 1)
+	 * @return		standard normal value with that cumulative probability,
+	 *				accurate to about 1e-9
+	 */
+	double normal_quantile(double p);
+
+	struct MarketRegime
+	{
+		// annualized drift and volatility while the regime lasts
+		double drift;
+		double volatility;
+	};
+
+	/**
+	 * Settings for the candles a MarketGenerator produces
+	 */
+	struct MarketModel
+	{
+		// seconds per candle
+		unsigned interval = 60;
+		// first open of every asset
+		double price = 100.0;
+		// annualized drift and volatility of the geometric Brownian motion
+		double drift = 0.0;
+		double volatility = 0.2;
+		// GARCH(1,1) weights of the last squared shock and the last variance,
+		// both 0 for constant volatility
+		double garch_alpha = 0.0;
+		double garch_beta = 0.0;
+		// regimes replace the drift and volatility above. After every candle
+		// the market moves to another regime with the switch chance.
+		std::vector<MarketRegime> regimes;
+		double regime_switch = 0.0;
+		// chance that a candle opens away from the last close, and the
+		// standard deviation of the log size of the gap
+		double gap_chance = 0.0;
+		double gap_size = 0.0;
+		// mean volume of a candle
+		double volume = 1000.0;
+	};
+
+	/**
+	 * @return	an error message or nullptr if the model is valid
+	 */
+	const char *check_market_model(const MarketModel& model);
+
+	/**
+	 * Generates synthetic candles for one or more assets that move together.
+	 * Every asset continues from where the last call left off, and the same
+	 * model, asset count and seed always give the same candles.
+	 */
+	class MarketGenerator
+	{
+	private:
+		MarketModel _model;
+		unsigned _assets = 1;
+		RandomStream _rng;
+		// lower triangular factor of the correlation matrix, empty if independent
+		std::vector<double> _cholesky;
+		unsigned _regime = 0;
+		std::vector<double> _close;
+		// GARCH variance relative to the long run variance
+		std::vector<double> _variance;
+		// draws of one block, laid out per asset
+		std::vector<double> _shocks;
+		std::vector<double> _uniform;
+		std::vector<double> _scratch;
+		std::vector<unsigned> _regimes;
+
+		void generate_block(Candle *const *out, size_t offset, unsigned count);
+
+	public:
+		MarketGenerator(const MarketModel& model = MarketModel(), unsigned assets = 1,
+			uint64_t seed = 1);
+
+		/**
+		 * Sets the same correlation between the returns of every pair of assets.
+		 *
+		 * @return	an error message or nullptr on success
+		 */
+		const char *set_correlation(double correlation);
+
+		/**
+		 * @param	matrix	row major correlation matrix of the asset returns
+		 * @return			an error message or nullptr on success
+		 */
+		const char *set_correlation(const std::vector<double>& matrix);
+
+		/**
+		 * @param	out		one array of count candles per asset
+		 */
+		void generate(Candle *const *out, unsigned count);
+
+		/**
+		 * Generates candles of the first asset only, for single asset generators.
+		 */
+		inline void generate(Candle *out, unsigned count) { generate(&out, count); }
+
+		/**
+		 * @return	next count candles of a single asset generator
+		 */
+		PriceHistory history(unsigned count);
+
+		/**
+		 * @return	next count candles of every asset
+		 */
+		std::vector<PriceHistory> basket(unsigned count);
+
+		inline unsigned assets() const { return _assets; }
+		inline double last_close(unsigned asset) const { return _close[asset]; }
+		inline const MarketModel& model() const { return _model; }
+	};
+}
+
+#endif
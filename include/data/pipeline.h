@@ -0,0 +1,134 @@
+#ifndef DAYTRENDER_PIPELINE_H
+#define DAYTRENDER_PIPELINE_H
+
+// local includes
+#include <data/eventqueue.h>
+#include <data/portfolio.h>
+#include <data/pricehistory.h>
+#include <data/worker.h>
+#include <util/parker.h>
+#include <util/ringbuffer.h>
+#include <util/threadpool.h>
+
+// standard library
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+// fetched histories that can wait for evaluation
+#define PIPELINE_CANDLE_CAPACITY 256
+// actions that can wait for execution
+#define PIPELINE_SIGNAL_CAPACITY 256
+
+namespace daytrender
+{
+	/**
+	 * Updates one portfolio in three stages that each run on their own
+	 * thread: ingest fetches candles, evaluate runs the strategies of every
+	 * fetched asset at once on a shared pool and execute places orders and
+	 * updates the account. A full queue blocks the stage before it, so a
+	 * slow broker never lets work pile up without bound.
+	 */
+	class Pipeline
+	{
+	private:
+		struct Candles
+		{
+			int asset = 0;
+			PriceHistory hist;
+			// epoch microseconds at which the candle closed
+			long long tick = 0;
+		};
+
+		struct Fetch
+		{
+			int asset;
+			long long tick;
+			std::future<Result<PriceHistory>> hist;
+		};
+
+		struct Signal
+		{
+			// asset index or Event::PORTFOLIO
+			int asset = 0;
+			unsigned action = 0;
+			// latest close of the asset
+			double price = 0.0;
+			long long tick = 0;
+		};
+
+		Portfolio& _portfolio;
+		ThreadPool& _pool;
+		SpscRing<Candles> _candles;
+		MpscRing<Signal> _signals;
+		Parker _evaluate_parker;
+		Parker _execute_parker;
+		std::atomic<bool> _running;
+		// epoch milliseconds at which each stage started its current item
+		std::atomic<long long> _evaluate_since;
+		std::atomic<long long> _execute_since;
+		std::thread _evaluate_thread;
+		std::thread _execute_thread;
+		// only used by ingest, kept so its capacity survives between ticks
+		std::vector<Fetch> _fetches;
+		// declared last so it stops feeding the other stages first
+		Worker _ingest;
+
+		void ingest(const std::vector<Event>& events);
+		void evaluate();
+		void execute();
+		void publish(Signal&& signal);
+
+		static inline long long elapsed(const std::atomic<long long>& since, long long now)
+		{
+			long long start = since.load(std::memory_order_relaxed);
+			return start ? now - start : 0;
+		}
+
+	public:
+		/**
+		 * @param	spin	times the evaluate and execute stages poll their queues
+		 *					before sleeping
+		 */
+		Pipeline(Portfolio& portfolio, ThreadPool& pool, unsigned spin = PARKER_SPIN_COUNT);
+		~Pipeline();
+
+		Pipeline(const Pipeline&) = delete;
+		Pipeline& operator=(const Pipeline&) = delete;
+
+		/**
+		 * Queues an event for the ingest stage.
+		 *
+		 * @return	false if the event was dropped
+		 */
+		inline bool push(const Event& event) { return _ingest.push(event); }
+
+		/**
+		 * Lets the stages finish their current items and joins them. Queued
+		 * items are discarded.
+		 */
+		void stop();
+
+		/**
+		 * Logs the throughput and depth of the queues between stages.
+		 */
+		void report() const;
+
+		/**
+		 * @param	now	current time in epoch milliseconds
+		 * @return		longest time a stage has spent on its current item
+		 */
+		long long busy_for(long long now) const;
+
+		inline std::thread& execute_thread() { return _execute_thread; }
+		inline const RingMetrics& candle_metrics() const { return _candles; }
+		inline const RingMetrics& signal_metrics() const { return _signals; }
+		inline size_t candle_depth() const { return _candles.size(); }
+		inline size_t signal_depth() const { return _signals.size(); }
+		inline size_t candle_capacity() const { return _candles.capacity(); }
+		inline size_t signal_capacity() const { return _signals.capacity(); }
+	};
+}
+
+#endif
@@ -3,9 +3,16 @@
 
 // local includes
 #include <data/asset.h>
+#include <data/equityhistory.h>
+#include <data/pretradecheck.h>
+#include <data/riskengine.h>
 #include <api/client.h>
+#include <util/latency.h>
+#include <util/metrics.h>
 
 //standard library
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,9 +20,25 @@
 #include <hirzel/data.h>
 
 #define PORTFOLIO_UPDATE_INTERVAL 60
+// room for this many equity samples per scheduled update, as samples are
+// also taken after orders. The history grows if there are more.
+#define EQUITY_HISTORY_HEADROOM 4
 
 namespace daytrender
 {
+	/**
+	 * Action a strategy returned for one asset of a portfolio
+	 */
+	struct AssetAction
+	{
+		unsigned asset = 0;
+		unsigned action = 0;
+		// latest close of the asset
+		double price = 0.0;
+		// epoch microseconds at which the candle closed, 0 if unknown
+		long long tick = 0;
+	};
+
 	class Portfolio
 	{
 	private:
@@ -26,6 +49,8 @@ namespace daytrender
 
 		// portfolio settings
 		bool _shorting_enabled = false;
+		// trade a tick's actions as one batch of orders toward target positions
+		bool _rebalance = false;
 		unsigned _asset_count = 0;
 		double _risk_sum = 0.0;
 		double _pl = 0.0;
@@ -33,12 +58,26 @@ namespace daytrender
 		double _max_loss = 0.05;
 		double _history_length = 24.0;
 		unsigned _closeout_buffer = 15 * 60;
+		// milliseconds to wait after a candle closes before fetching it
+		unsigned _update_offset = 250;
+		// seconds an update may take before the portfolio is considered stuck
+		unsigned _timeout = 30;
 
 		// data
 		std::string _label;
 		Client _client;
 		std::vector<Asset> _assets;
-		std::vector<std::pair<long long, double>> _equity_history;
+		EquityHistory _equity_history;
+		RiskEngine _risk_engine;
+		PreTradeCheck _pretrade;
+		// recording doesn't change the portfolio, so it may happen in const calls
+		mutable LatencyTracker _latency;
+		// latest equity for the metrics endpoint, which reads it from another thread
+		std::shared_ptr<PortfolioGauges> _gauges = std::make_shared<PortfolioGauges>();
+
+		const char *enter_position(unsigned index, bool short_shares, long long tick);
+		const char *exit_position(unsigned index, bool short_shares, long long tick);
+		void rebalance(const std::vector<AssetAction>& actions);
 
 	public:
 		Portfolio() = default;
@@ -46,6 +85,21 @@ namespace daytrender
 			const std::string& dir);
 
 		void update();
+		void update_asset(unsigned index);
+		Result<PriceHistory> fetch_asset(unsigned index);
+		std::future<Result<PriceHistory>> fetch_asset_async(unsigned index) const;
+		unsigned evaluate_asset(unsigned index, const PriceHistory& hist);
+		/**
+		 * @param	tick	epoch microseconds at which the candle that led to the
+		 *					action closed, 0 if unknown
+		 */
+		void execute_action(unsigned index, unsigned action, double price, long long tick = 0);
+
+		/**
+		 * Executes the actions of one tick. In rebalance mode they are netted
+		 * into a single batch of orders, otherwise each is executed on its own.
+		 */
+		void execute_actions(const std::vector<AssetAction>& actions);
 		void update_assets();
 		
 		double risk_sum() const;
@@ -53,6 +107,15 @@ namespace daytrender
 		Asset *get_asset(const std::string& ticker);
 		inline Client& get_client() { return _client; }
 		inline std::string label() const { return _label; }
+		inline const std::vector<Asset>& assets() const { return _assets; }
+		inline const EquityHistory& equity_history() const { return _equity_history; }
+		inline const RiskEngine& risk_engine() const { return _risk_engine; }
+		inline LatencyTracker& latency() { return _latency; }
+		inline const LatencyTracker& latency() const { return _latency; }
+		inline const PortfolioGauges& gauges() const { return *_gauges; }
+		inline unsigned update_offset() const { return _update_offset; }
+		inline unsigned timeout() const { return _timeout; }
+		inline bool is_rebalancing() const { return _rebalance; }
 
 		/**
 		 *	@return	State on whether its client and assets are bound 
@@ -0,0 +1,86 @@
+#ifndef DAYTRENDER_PRETRADECHECK_H
+#define DAYTRENDER_PRETRADECHECK_H
+
+// standard library
+#include <cstddef>
+#include <vector>
+
+namespace daytrender
+{
+	/**
+	 * Limits for orders of one instrument, 0 if unlimited
+	 */
+	struct PreTradeLimits
+	{
+		// value of a single order
+		double max_notional = 0.0;
+		// absolute shares held after an order
+		double max_position = 0.0;
+		// ratio an order price may differ from the last close
+		double max_deviation = 0.0;
+		// orders per second, with bursts up to the same number but at least one
+		double max_rate = 0.0;
+		// microseconds during which the same order is rejected as a duplicate
+		long long duplicate_window = 0;
+	};
+
+	/**
+	 * Sanity checks run right before an order is sent. Limits and state for
+	 * each instrument sit next to each other in a flat array, so a check
+	 * only touches that instrument's entry and never locks or allocates.
+	 *
+	 * Not thread safe: it is owned by the thread that places the orders.
+	 */
+	class PreTradeCheck
+	{
+	private:
+		struct alignas(64) Instrument
+		{
+			PreTradeLimits limits;
+			double last_close = 0.0;
+			// order rate token bucket
+			double tokens = 0.0;
+			long long refilled = 0;
+			// last order, for the duplicate guard
+			double last_shares = 0.0;
+			long long last_order = 0;
+		};
+
+		std::vector<Instrument> _instruments;
+
+	public:
+		PreTradeCheck() = default;
+		PreTradeCheck(size_t instruments, const PreTradeLimits& limits = {});
+
+		void set_limits(unsigned instrument, const PreTradeLimits& limits);
+		inline void set_close(unsigned instrument, double close)
+		{
+			_instruments[instrument].last_close = close;
+		}
+
+		/**
+		 * @param	shares		shares to order, negative to sell
+		 * @param	price		price the order is expected to fill at
+		 * @param	position	shares held before the order
+		 * @param	now			current time in microseconds
+		 * @return				reason the order is rejected or nullptr if it passes
+		 */
+		const char *check(unsigned instrument, double shares, double price,
+			double position, long long now);
+
+		/**
+		 * Counts an order that was sent toward the rate limit and duplicate
+		 * guard.
+		 */
+		void record(unsigned instrument, double shares, long long now);
+
+		inline const PreTradeLimits& limits(unsigned instrument) const
+		{
+			return _instruments[instrument].limits;
+		}
+
+		inline size_t size() const { return _instruments.size(); }
+	};
+}
+
+#endif
@@ -27,6 +27,7 @@ namespace daytrender
 		~PriceHistory();
 
 		PriceHistory& operator=(const PriceHistory& other);
+		PriceHistory& operator=(PriceHistory&& other);
 
 		PriceHistory slice(unsigned offset, unsigned size) const
 		{
@@ -0,0 +1,25 @@
+#ifndef DAYTRENDER_REBALANCE_H
+#define DAYTRENDER_REBALANCE_H
+
+// local includes
+#include <data/position.h>
+#include <data/result.h>
+
+// standard library
+#include <functional>
+
+namespace daytrender
+{
+	/**
+	 * Nets the latest action of an asset against the position it holds.
+	 *
+	 * @param	target	gets the signed shares to hold after entering, given
+	 *					whether the entry is short
+	 * @return	signed shares to order rounded to the order minimum, or an
+	 *			error if the action can't be sized
+	 */
+	Result<double> rebalance_shares(unsigned action, const Position& pos,
+		const std::function<double(bool)>& target);
+}
+
+#endif
@@ -1,10 +1,15 @@
 #ifndef HIRZEL_RESULT_H
 #define HIRZEL_RESULT_H
 
+#include <new>
 #include <utility>
 
 namespace daytrender
 {
+	/**
+	 * Either a value or an error message. The value is stored inline, so
+	 * returning a result never allocates.
+	 */
 	template <typename T>
 	class Result
 	{
@@ -13,59 +18,100 @@ namespace daytrender
 
 		union
 		{
-			const char *error = nullptr;
-			T *value;
-		} _data;
+			const char *_error;
+			T _value;
+		};
 
-	public:
-		Result(T&& value)
+		void assign(const Result& other)
 		{
-			_ok = true;
-			_data.value = new T(value);
+			_ok = other._ok;
+			if (_ok)
+			{
+				new (&_value) T(other._value);
+			}
+			else
+			{
+				_error = other._error;
+			}
 		}
 
-		Result(Result&& other)
+		void assign(Result&& other)
 		{
 			_ok = other._ok;
-			_data = other._data;
-			other._ok = false;
+			if (_ok)
+			{
+				new (&_value) T(std::move(other._value));
+			}
+			else
+			{
+				_error = other._error;
+			}
 		}
 
-		Result(const Result& other)
+		void reset()
 		{
-			*this = other;
+			if (_ok) _value.~T();
+			_ok = false;
+			_error = nullptr;
 		}
 
-		Result(const char *error)
+	public:
+		Result(T&& value) :
+		_ok(true),
+		_value(std::move(value))
+		{}
+
+		Result(const T& value) :
+		_ok(true),
+		_value(value)
+		{}
+
+		Result(const char *error) :
+		_error(error)
+		{}
+
+		Result(Result&& other)
 		{
-			_data.error = error;
+			assign(std::move(other));
+		}
+
+		Result(const Result& other)
+		{
+			assign(other);
 		}
 
 		~Result()
 		{
-			if (_ok) delete _data.value;
+			if (_ok) _value.~T();
 		}
 
 		inline T&& get()
 		{
-			return std::move(*_data.value);
+			return std::move(_value);
 		}
 
-		inline T value() { return _data.value; }
-		inline const char* error() { return _data.error; }
-		inline bool ok() { return _ok; }
+		inline const T& value() const { return _value; }
+		inline const char* error() const { return _ok ? nullptr : _error; }
+		inline bool ok() const { return _ok; }
 
 		Result& operator=(const Result& other)
 		{
-			_ok = other.ok();
-			if (_ok)
+			if (this != &other)
 			{
-				_data.value = other.get();
+				reset();
+				assign(other);
 			}
-			else
+			return *this;
+		}
+
+		Result& operator=(Result&& other)
+		{
+			if (this != &other)
 			{
-				_data.error = other.error();
+				reset();
+				assign(std::move(other));
 			}
+			return *this;
 		}
 
 		inline operator bool() const { return _ok; }
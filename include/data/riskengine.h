@@ -0,0 +1,120 @@
+#ifndef DAYTRENDER_RISKENGINE_H
+#define DAYTRENDER_RISKENGINE_H
+
+// standard library
+#include <string>
+#include <vector>
+
+// weight of the previous covariance in each update (RiskMetrics daily decay)
+#define RISK_DEFAULT_DECAY 0.94
+// standard score for a one-sided 99% value at risk
+#define RISK_VAR_Z 2.326
+// updates between exact recalculations of the portfolio variance
+#define RISK_RECALC_INTERVAL 1024
+
+namespace daytrender
+{
+	/**
+	 * Limits as ratios of account equity, 0 if unlimited
+	 */
+	struct RiskLimits
+	{
+		// sum of the absolute value of every position
+		double gross = 0.0;
+		// absolute value of the sum of every position
+		double net = 0.0;
+		// absolute exposure to any single currency
+		double currency = 0.0;
+		// value at risk over one candle
+		double var = 0.0;
+	};
+
+	/**
+	 * Keeps exposure, covariance of returns and value at risk of a portfolio
+	 * up to date as prices and positions change. A price or position update
+	 * costs O(assets) and checking an order costs O(1), so an order can be
+	 * vetoed or resized without recalculating anything.
+	 *
+	 * Not thread safe: it is owned by the thread that places the orders.
+	 */
+	class RiskEngine
+	{
+	private:
+		RiskLimits _limits;
+		double _decay = RISK_DEFAULT_DECAY;
+		double _equity = 0.0;
+
+		// per asset
+		std::vector<double> _shares;
+		std::vector<double> _prices;
+		// latest log return of each asset
+		std::vector<double> _returns;
+		// value of each position
+		std::vector<double> _weights;
+		std::vector<int> _base;
+		std::vector<int> _quote;
+
+		// row major EWMA covariance of returns
+		std::vector<double> _cov;
+		// covariance times weights, kept so weight changes are O(assets)
+		std::vector<double> _cov_weights;
+		double _variance = 0.0;
+		unsigned _updates = 0;
+
+		// per currency
+		std::vector<std::string> _currencies;
+		std::vector<double> _exposure;
+
+		double _gross = 0.0;
+		double _net = 0.0;
+
+		int currency_index(const std::string& currency);
+		void set_weight(unsigned asset, double weight);
+		void update_covariance(unsigned asset, double ret);
+		void recalculate();
+
+		inline double& cov(unsigned i, unsigned j) { return _cov[i * _shares.size() + j]; }
+		inline double cov(unsigned i, unsigned j) const { return _cov[i * _shares.size() + j]; }
+
+	public:
+		RiskEngine() = default;
+
+		/**
+		 * @param	tickers	assets in portfolio order. Pairs like EUR_USD or
+		 *					EUR/USD count toward both currencies, anything
+		 *					else counts as its own currency.
+		 */
+		RiskEngine(const std::vector<std::string>& tickers, const RiskLimits& limits,
+			double decay = RISK_DEFAULT_DECAY);
+
+		void update_price(unsigned asset, double price);
+		void add_shares(unsigned asset, double shares);
+		void set_shares(unsigned asset, double shares);
+		inline void set_equity(double equity) { _equity = equity; }
+
+		/**
+		 * Finds how much of an order may be placed without breaking a limit.
+		 * An order may always reduce how far a limit is exceeded but never
+		 * increase it.
+		 *
+		 * @param	asset	index of the asset
+		 * @param	shares	shares that are to be ordered, negative to sell
+		 * @return			shares that may be ordered, between 0 and shares
+		 */
+		double limit_order(unsigned asset, double shares) const;
+
+		// getters
+		inline const RiskLimits& limits() const { return _limits; }
+		inline double equity() const { return _equity; }
+		inline double gross() const { return _gross; }
+		inline double net() const { return _net; }
+		inline double variance() const { return _variance; }
+		double value_at_risk() const;
+		double volatility(unsigned asset) const;
+		inline double shares(unsigned asset) const { return _shares[asset]; }
+		inline const std::vector<std::string>& currencies() const { return _currencies; }
+		inline const std::vector<double>& exposure() const { return _exposure; }
+	};
+}
+
+#endif
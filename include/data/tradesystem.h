@@ -8,13 +8,23 @@
 #define DAYTRENDER_TRADESYSTEM_H
 
 // local includes
+#include <data/eventqueue.h>
+#include <data/pipeline.h>
 #include <data/portfolio.h>
+#include <util/lowlatency.h>
+#include <util/metrics.h>
+#include <util/threadpool.h>
 
 // standard library
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <mutex>
 
+// external libraries
+#include <hirzel/data.h>
+
 namespace daytrender
 {
 	class TradeSystem
@@ -22,10 +32,30 @@ namespace daytrender
 	private:
 		bool _running = false;
 		bool _initialized = false;
+		bool _serving = false;
+		std::string _dir;
 		std::mutex _mtx;
 		std::vector<Portfolio> _portfolios;
+		EventQueue _events;
+		std::unique_ptr<ThreadPool> _pool;
+		std::vector<std::unique_ptr<Pipeline>> _pipelines;
+		std::vector<bool> _stalled;
+		LowLatencySettings _low_latency;
+		JitterStats _jitter;
+		std::thread _server_thread;
+		// asset events dispatched before allocations in a tick are reported,
+		// 0 if they never are
+		unsigned long long _steady_state_after = 0;
 
 		bool init(const std::string& dir);
+		bool init_low_latency(const hirzel::Data& config);
+		bool init_allocations(const hirzel::Data& config);
+		void apply_low_latency();
+		void schedule_asset(unsigned portfolio, unsigned asset, long long now);
+		void supervise(long long now);
+		void dump_latency() const;
+		void dump_trace() const;
+		void dump_allocations() const;
 
 	public:
 		TradeSystem(const std::string& dir);
@@ -33,7 +63,8 @@ namespace daytrender
 		void start();
 
 		/**
-		 * Changes running to false. This will interrupt the program loop.
+		 * Changes running to false and wakes up the program loop so that it
+		 * returns immediately.
 		 */
 		void stop();
 
@@ -48,6 +79,12 @@ namespace daytrender
 		inline bool is_running() const { return _running; }
 		inline bool is_initialized() const { return _initialized; }
 		Portfolio *get_portfolio(const std::string& label);
+
+		/**
+		 * @return	depth of the queues between the pipeline stages of every
+		 *			portfolio, empty while the trade system isn't running
+		 */
+		std::vector<QueueMetrics> queue_metrics();
 	};
 }
 
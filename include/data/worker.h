@@ -0,0 +1,71 @@
+#ifndef DAYTRENDER_WORKER_H
+#define DAYTRENDER_WORKER_H
+
+// local includes
+#include <data/eventqueue.h>
+
+// standard library
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// events a worker can have waiting before new ones are dropped
+#define WORKER_QUEUE_CAPACITY 256
+
+namespace daytrender
+{
+	/**
+	 * Thread that handles the events of one portfolio in order. Every event
+	 * waiting when the thread wakes up is handed over as one batch. Its queue
+	 * is bounded and ignores events that are already waiting, so a portfolio
+	 * that falls behind never builds up a backlog.
+	 */
+	class Worker
+	{
+	private:
+		std::function<void(const std::vector<Event>&)> _handler;
+		std::deque<Event> _queue;
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		std::thread _thread;
+		bool _running = true;
+		// epoch milliseconds at which the current batch started, 0 when idle
+		std::atomic<long long> _busy_since;
+
+		void run();
+
+	public:
+		Worker(std::function<void(const std::vector<Event>&)> handler);
+		~Worker();
+
+		/**
+		 * Queues an event for the worker.
+		 *
+		 * @return	false if the event was dropped because the queue is full or
+		 *			the same event is already waiting
+		 */
+		bool push(const Event& event);
+
+		/**
+		 * Finishes the current batch and joins the thread. Waiting events
+		 * are discarded.
+		 */
+		void stop();
+
+		/**
+		 * @param	now	current time in epoch milliseconds
+		 * @return		milliseconds spent on the current batch, 0 if idle
+		 */
+		inline long long busy_for(long long now) const
+		{
+			long long since = _busy_since.load(std::memory_order_relaxed);
+			return since ? now - since : 0;
+		}
+	};
+}
+
+#endif
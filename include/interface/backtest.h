@@ -13,6 +13,18 @@
 
 namespace daytrender
 {
+	/**
+	 * Runs a strategy over every window of the candles and trades its
+	 * actions on the paper account.
+	 *
+	 * @param	ranges	indicator ranges to test, or empty for the asset's own.
+	 *					None may be larger than the asset's.
+	 * @return	false if the strategy failed
+	 */
+	bool backtest_permutation(PaperAccount& acc, const Asset& asset,
+		const PriceHistory& candles, const Strategy *strat,
+		const std::vector<int>& ranges);
+
 	namespace interface
 	{
 		std::vector<PaperAccount> backtest(int strat_index, int asset_index, double principal,
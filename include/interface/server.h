@@ -1,14 +1,34 @@
-#pragma once
+#ifndef DAYTRENDER_SERVER_H
+#define DAYTRENDER_SERVER_H
 
+// standard library
 #include <string>
-#include <picojson.h>
+
+// external libraries
+#include <hirzel/data.h>
 
 namespace daytrender
 {
+	class TradeSystem;
+
 	namespace server
 	{
-		bool init(const picojson::value& config, const std::string& dir);
+		/**
+		 * Reads the "server" entry of portfolios.json and registers the
+		 * handlers.
+		 *
+		 * @param	config	table with the ip and port to listen on
+		 * @param	system	trade system that the handlers report on
+		 * @param	dir		directory the web interface is read from
+		 */
+		bool init(const hirzel::Data& config, TradeSystem& system, const std::string& dir);
+
+		/**
+		 * Listens for requests until stop is called.
+		 */
 		void start();
 		void stop();
 	}
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef DAYTRENDER_ALLOCATIONS_H
+#define DAYTRENDER_ALLOCATIONS_H
+
+// local includes
+#include <util/metrics.h>
+
+// standard library
+#include <atomic>
+#include <cstddef>
+
+// distinct call stacks printed in steady state, later ones are only counted
+#define STEADY_STATE_REPORT_LIMIT 64
+// frames printed of every call stack
+#define STEADY_STATE_STACK_DEPTH 24
+
+#define ALLOCATION_CONCAT_INNER(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_INNER(a, b)
+
+/**
+ * Attributes heap allocations made by the calling thread to a subsystem
+ * until the enclosing scope ends.
+ */
+#define ALLOCATION_SCOPE(subsystem) daytrender::AllocationScope \
+	ALLOCATION_CONCAT(allocation_scope_, __LINE__)(subsystem)
+
+/**
+ * Like ALLOCATION_SCOPE, and also marks the scope as part of a tick, where
+ * allocations are reported once steady state is reached.
+ */
+#define TICK_ALLOCATION_SCOPE(subsystem) daytrender::AllocationScope \
+	ALLOCATION_CONCAT(allocation_scope_, __LINE__)(subsystem, true)
+
+namespace daytrender
+{
+	/**
+	 * Subsystem the calling thread allocates for. Kept trivial so it needs
+	 * no initialization that could allocate.
+	 */
+	struct AllocationContext
+	{
+		unsigned char subsystem;
+		bool tick;
+		// set while an allocation is being counted so the counting itself isn't
+		bool busy;
+	};
+
+	inline thread_local AllocationContext allocation_context = { ALLOC_OTHER, false, false };
+
+	class AllocationScope
+	{
+	private:
+		AllocationContext _previous;
+
+	public:
+		/**
+		 * @param	tick	marks the scope as part of a tick. Scopes nested
+		 *					in a tick are part of it either way.
+		 */
+		inline AllocationScope(AllocSubsystem subsystem, bool tick = false) :
+		_previous(allocation_context)
+		{
+			allocation_context.subsystem = (unsigned char)subsystem;
+			allocation_context.tick = tick || _previous.tick;
+		}
+
+		inline ~AllocationScope()
+		{
+			allocation_context.subsystem = _previous.subsystem;
+			allocation_context.tick = _previous.tick;
+		}
+
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+	};
+
+	/**
+	 * @return	whether the calling thread is inside a tick
+	 */
+	inline bool in_tick() { return allocation_context.tick; }
+
+	/**
+	 * Starts or stops counting allocations per subsystem. While stopped the
+	 * hook only checks a flag.
+	 */
+	void set_allocation_accounting(bool enabled);
+	bool is_accounting_allocations();
+
+	/**
+	 * Starts or stops reporting allocations made during a tick. Every
+	 * distinct call stack is printed to stderr once, and all of them are
+	 * counted. Reporting implies accounting.
+	 */
+	void set_steady_state(bool enabled);
+	bool is_steady_state();
+
+	/**
+	 * Called by the global operator new for every allocation.
+	 */
+	void account_allocation(size_t size);
+}
+
+#endif
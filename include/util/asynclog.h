@@ -0,0 +1,199 @@
+#ifndef DAYTRENDER_ASYNCLOG_H
+#define DAYTRENDER_ASYNCLOG_H
+
+// standard library
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#define LOG_LEVEL_DEBUG		0
+#define LOG_LEVEL_INFO		1
+#define LOG_LEVEL_WARNING	2
+#define LOG_LEVEL_ERROR		3
+
+// messages below this level are compiled out
+#ifndef DAYTRENDER_LOG_LEVEL
+#ifdef NDEBUG
+#define DAYTRENDER_LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define DAYTRENDER_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// bytes of arguments a message can carry, longer strings are cut short
+#define ASYNC_LOG_ARG_BYTES 232
+// messages that can wait for the log thread before new ones are dropped
+#define ASYNC_LOG_CAPACITY 4096
+// milliseconds the log thread sleeps once it has caught up
+#define ASYNC_LOG_INTERVAL 5
+
+/**
+ * Logging for hot paths. The arguments are copied into a queue and the log
+ * thread formats and writes them through the regular logger, so the caller
+ * never waits on formatting or I/O. The format must be a string literal and
+ * the arguments numbers, pointers or strings.
+ */
+#if DAYTRENDER_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define ASYNC_DEBUG(...) daytrender::async_log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define ASYNC_DEBUG(...) ((void)0)
+#endif
+
+#if DAYTRENDER_LOG_LEVEL <= LOG_LEVEL_INFO
+#define ASYNC_INFO(...) daytrender::async_log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define ASYNC_INFO(...) ((void)0)
+#endif
+
+#if DAYTRENDER_LOG_LEVEL <= LOG_LEVEL_WARNING
+#define ASYNC_WARNING(...) daytrender::async_log(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define ASYNC_WARNING(...) ((void)0)
+#endif
+
+#if DAYTRENDER_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define ASYNC_ERROR(...) daytrender::async_log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define ASYNC_ERROR(...) ((void)0)
+#endif
+
+namespace daytrender
+{
+	enum LogArgType
+	{
+		LOG_ARG_INT,
+		LOG_ARG_UINT,
+		LOG_ARG_DOUBLE,
+		LOG_ARG_POINTER,
+		LOG_ARG_STRING,
+		// the remaining arguments did not fit
+		LOG_ARG_TRUNCATED
+	};
+
+	/**
+	 * Message whose arguments are stored raw, each as a type byte followed
+	 * by the value or by a length byte and the characters of a string. The
+	 * last byte is kept free to mark where arguments were cut off.
+	 */
+	struct LogRecord
+	{
+		unsigned char level = 0;
+		unsigned short size = 0;
+		const char *format = nullptr;
+		// epoch microseconds at which it was submitted
+		long long time = 0;
+		char args[ASYNC_LOG_ARG_BYTES];
+
+		template <typename T>
+		inline void put(LogArgType type, T value)
+		{
+			if (size + 1 + sizeof(T) >= ASYNC_LOG_ARG_BYTES)
+			{
+				truncate();
+				return;
+			}
+
+			args[size] = (char)type;
+			std::memcpy(args + size + 1, &value, sizeof(T));
+			size += 1 + sizeof(T);
+		}
+
+		inline void put_string(const char *str, size_t length)
+		{
+			if (size + 2 >= ASYNC_LOG_ARG_BYTES)
+			{
+				truncate();
+				return;
+			}
+
+			size_t room = ASYNC_LOG_ARG_BYTES - size - 3;
+			if (length > room) length = room;
+			if (length > 255) length = 255;
+
+			args[size] = (char)LOG_ARG_STRING;
+			args[size + 1] = (char)(unsigned char)length;
+			std::memcpy(args + size + 2, str, length);
+			size += 2 + length;
+		}
+
+		inline void truncate()
+		{
+			if (size < ASYNC_LOG_ARG_BYTES) args[size++] = (char)LOG_ARG_TRUNCATED;
+			// nothing else is added once an argument didn't fit
+			size = ASYNC_LOG_ARG_BYTES;
+		}
+	};
+
+	template <typename T>
+	struct LogArgUnsupported : std::false_type {};
+
+	template <typename T>
+	inline void encode_log_arg(LogRecord& record, const T& value)
+	{
+		if constexpr (std::is_same<T, std::string>::value)
+		{
+			record.put_string(value.data(), value.size());
+		}
+		else if constexpr (std::is_convertible<const T&, const char*>::value)
+		{
+			const char *str = value;
+			if (!str) str = "(null)";
+			record.put_string(str, std::strlen(str));
+		}
+		else if constexpr (std::is_floating_point<T>::value)
+		{
+			record.put(LOG_ARG_DOUBLE, (double)value);
+		}
+		else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value)
+		{
+			record.put(LOG_ARG_INT, (long long)value);
+		}
+		else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value)
+		{
+			record.put(LOG_ARG_UINT, (unsigned long long)value);
+		}
+		else if constexpr (std::is_pointer<T>::value)
+		{
+			record.put(LOG_ARG_POINTER, (const void*)value);
+		}
+		else
+		{
+			static_assert(LogArgUnsupported<T>::value, "type cannot be logged asynchronously");
+		}
+	}
+
+	/**
+	 * Stamps a message with the current time and queues it for the log
+	 * thread, or logs it right away if the thread isn't running. Never
+	 * blocks: if the queue is full the message is dropped and counted.
+	 */
+	void submit_log(LogRecord&& record);
+
+	template <typename... Args>
+	inline void async_log(unsigned level, const char *format, const Args&... args)
+	{
+		LogRecord record;
+		record.level = (unsigned char)level;
+		record.format = format;
+		(encode_log_arg(record, args), ...);
+		submit_log(std::move(record));
+	}
+
+	/**
+	 * @return	message with its arguments substituted into the format
+	 */
+	std::string format_log(const LogRecord& record);
+
+	/**
+	 * Starts the thread that writes queued messages.
+	 */
+	void start_async_log();
+
+	/**
+	 * Writes every queued message and joins the log thread. Messages logged
+	 * afterwards are written on the calling thread.
+	 */
+	void stop_async_log();
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef DAYTRENDER_BENCHMARK_H
+#define DAYTRENDER_BENCHMARK_H
+
+// standard library
+#include <string>
+#include <vector>
+
+// nanoseconds each sample should run for once calibrated
+#define BENCH_SAMPLE_NANOS 20000000
+// samples taken of every benchmark, the median is reported
+#define BENCH_SAMPLE_COUNT 15
+
+/**
+ * Defines a benchmark that is run by daytrender_bench. The body runs
+ * state.iterations() operations and may report how many items each
+ * operation processed with state.set_items().
+ */
+#define BENCHMARK(name) BENCHMARK_BUDGET(name, 0.0)
+
+/**
+ * Defines a benchmark that fails the run if its median time per operation
+ * is above budget nanoseconds.
+ */
+#define BENCHMARK_BUDGET(name, budget) \
+	static void bench_##name(daytrender::BenchState& state); \
+	static daytrender::BenchRegistrar bench_registrar_##name(#name, bench_##name, budget); \
+	static void bench_##name(daytrender::BenchState& state)
+
+namespace daytrender
+{
+	class Asset;
+	class PriceHistory;
+
+	class BenchState
+	{
+	private:
+		unsigned long long _iterations;
+		double _items = 1.0;
+		const char *_unit = "ops";
+		std::string _skipped;
+
+	public:
+		BenchState(unsigned long long iterations) : _iterations(iterations) {}
+
+		/**
+		 * @param	items	items processed by a single operation
+		 * @param	unit	name of the items for the throughput
+		 */
+		inline void set_items(double items, const char *unit)
+		{
+			_items = items;
+			_unit = unit;
+		}
+
+		/**
+		 * Marks the benchmark as unable to run, e.g. when a plugin is missing.
+		 */
+		inline void skip(const std::string& reason) { _skipped = reason; }
+
+		inline unsigned long long iterations() const { return _iterations; }
+		inline double items() const { return _items; }
+		inline const char *unit() const { return _unit; }
+		inline bool skipped() const { return !_skipped.empty(); }
+		inline const std::string& skip_reason() const { return _skipped; }
+	};
+
+	struct BenchCase
+	{
+		const char *name;
+		void (*func)(BenchState&);
+		// nanoseconds per operation, 0 if unlimited
+		double budget;
+	};
+
+	inline std::vector<BenchCase>& bench_cases()
+	{
+		static std::vector<BenchCase> cases;
+		return cases;
+	}
+
+	struct BenchRegistrar
+	{
+		BenchRegistrar(const char *name, void (*func)(BenchState&), double budget)
+		{
+			bench_cases().push_back({ name, func, budget });
+		}
+	};
+
+	/**
+	 * Keeps the compiler from optimizing away a value that is never read.
+	 */
+	template <typename T>
+	inline void bench_keep(const T& value)
+	{
+		asm volatile("" : : "r"(&value) : "memory");
+	}
+
+	/**
+	 * Directory that daytrender_bench was started from, where it looks for
+	 * plugins.
+	 */
+	inline std::string& bench_dir()
+	{
+		static std::string dir;
+		return dir;
+	}
+
+	/**
+	 * @return	random walk of candles that is the same on every run
+	 */
+	PriceHistory bench_candles(unsigned count, unsigned seed = 1);
+
+	/**
+	 * Skips the benchmark if the strategy plugin couldn't be loaded.
+	 *
+	 * @return	asset bound to the benchmarked strategy or nullptr if it couldn't be loaded
+	 */
+	const Asset *bench_asset(BenchState& state);
+}
+
+#endif
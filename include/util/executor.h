@@ -0,0 +1,67 @@
+#ifndef DAYTRENDER_EXECUTOR_H
+#define DAYTRENDER_EXECUTOR_H
+
+// standard library
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace daytrender
+{
+	/**
+	 * Fixed set of threads that run submitted tasks by priority, and tasks
+	 * of the same priority in the order they were submitted. Each task hands
+	 * back a future, so a caller can start several blocking requests and
+	 * wait for all of them at once.
+	 */
+	class Executor
+	{
+	private:
+		std::vector<std::thread> _threads;
+		// one queue per priority, the first is run first
+		std::vector<std::deque<std::function<void()>>> _tasks;
+		unsigned _pending = 0;
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		bool _running = true;
+
+		void run();
+		void post(unsigned priority, std::function<void()>&& task);
+
+	public:
+		/**
+		 * @param	priorities	number of priorities tasks can be submitted with
+		 */
+		Executor(unsigned threads, unsigned priorities = 1);
+		~Executor();
+
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+
+		/**
+		 * @param	priority	0 runs first, priorities past the last count as the last
+		 */
+		template <typename Func>
+		std::future<std::invoke_result_t<Func>> submit(unsigned priority, Func&& func)
+		{
+			typedef std::invoke_result_t<Func> Ret;
+
+			// std::function needs something copyable
+			auto task = std::make_shared<std::packaged_task<Ret()>>(std::forward<Func>(func));
+			std::future<Ret> out = task->get_future();
+			post(priority, [task]() { (*task)(); });
+
+			return out;
+		}
+
+		inline unsigned size() const { return _threads.size(); }
+	};
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef DAYTRENDER_JSONREADER_H
+#define DAYTRENDER_JSONREADER_H
+
+// standard library
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+namespace daytrender
+{
+	enum JsonToken
+	{
+		JSON_END,
+		JSON_ERROR,
+		JSON_OBJECT,
+		JSON_OBJECT_END,
+		JSON_ARRAY,
+		JSON_ARRAY_END,
+		JSON_KEY,
+		JSON_STRING,
+		JSON_NUMBER,
+		JSON_TRUE,
+		JSON_FALSE,
+		JSON_NULL
+	};
+
+	/**
+	 * Forward-only JSON tokenizer that reads directly out of a response
+	 * buffer. Nothing is copied or allocated: keys, strings and numbers are
+	 * exposed as views into the buffer and converted on demand, so clients
+	 * can decode straight into PriceHistory, Account and Position.
+	 *
+	 * Escape sequences are not decoded. The views are meant for keys,
+	 * identifiers and numbers, which is all the client payloads contain.
+	 */
+	class JsonReader
+	{
+	private:
+		const char *_pos = nullptr;
+		const char *_end = nullptr;
+		const char *_str = nullptr;
+		size_t _len = 0;
+		unsigned _depth = 0;
+
+		JsonToken read_string();
+		JsonToken read_number();
+		JsonToken read_literal(const char *literal, size_t len, JsonToken token);
+
+	public:
+		JsonReader(const char *data, size_t size);
+		JsonReader(std::string_view str) : JsonReader(str.data(), str.size()) {}
+
+		/**
+		 * Advances to the next token. Commas and colons are consumed
+		 * silently and a string followed by a colon is reported as a key.
+		 */
+		JsonToken next();
+
+		/**
+		 * Skips the value that comes next. Objects and arrays are skipped as a
+		 * whole by scanning for their closing bracket.
+		 *
+		 * @return	false if the buffer ended before the value did
+		 */
+		bool skip();
+
+		/**
+		 * Advances through the current object until the given key is found,
+		 * skipping the values of every other key.
+		 *
+		 * @return	true if the key was found, false if the object ended
+		 */
+		bool find(const char *key);
+
+		double to_double() const;
+		long long to_int() const;
+
+		inline bool equals(const char *str) const
+		{
+			return std::strlen(str) == _len && !std::memcmp(str, _str, _len);
+		}
+
+		inline std::string_view view() const { return { _str, _len }; }
+		inline unsigned depth() const { return _depth; }
+	};
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef DAYTRENDER_LATENCY_H
+#define DAYTRENDER_LATENCY_H
+
+// standard library
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// bits of precision kept below the leading bit, about 3% relative error
+#define LATENCY_SUB_BUCKET_BITS 5
+// nanoseconds above 2^LATENCY_MAX_BITS are counted in the last bucket
+#define LATENCY_MAX_BITS 36
+
+namespace daytrender
+{
+	/**
+	 * Points between a candle closing and its order returning at which
+	 * latency is recorded
+	 */
+	enum LatencyStage
+	{
+		// event queue waking up after the update was due
+		STAGE_WAKEUP,
+		// price history request and parsing in the client plugin
+		STAGE_FETCH,
+		// strategy execution
+		STAGE_EVALUATE,
+		// account and position queries and sizing of an order
+		STAGE_SIZING,
+		// order submission until it was filled or rejected
+		STAGE_ORDER,
+		// candle close until an order returned
+		STAGE_TICK_TO_ORDER,
+		STAGE_COUNT
+	};
+
+	const char *stage_name(unsigned stage);
+
+	/**
+	 * @return	nanoseconds on a clock that only moves forward, for timing stages
+	 */
+	inline long long monotonic_nanos()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * Log-linear histogram of nanosecond durations in the style of
+	 * HdrHistogram. Recording is a single relaxed atomic add so threads
+	 * never lock, and histograms can be read while they are written to.
+	 */
+	class LatencyHistogram
+	{
+	public:
+		static constexpr unsigned SUB_BUCKETS = 1u << LATENCY_SUB_BUCKET_BITS;
+		static constexpr unsigned BUCKET_COUNT = 2 * SUB_BUCKETS
+			+ (LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+	private:
+		std::atomic<uint64_t> _buckets[BUCKET_COUNT];
+		std::atomic<uint64_t> _count;
+		std::atomic<uint64_t> _sum;
+		std::atomic<uint64_t> _max;
+
+	public:
+		LatencyHistogram();
+		LatencyHistogram(const LatencyHistogram& other);
+		LatencyHistogram& operator=(const LatencyHistogram& other);
+
+		static inline unsigned index_of(uint64_t value)
+		{
+			if (value < 2 * SUB_BUCKETS) return (unsigned)value;
+			if (value >> LATENCY_MAX_BITS) value = (1ULL << LATENCY_MAX_BITS) - 1;
+
+			unsigned msb = 63 - __builtin_clzll(value);
+			unsigned shift = msb - LATENCY_SUB_BUCKET_BITS;
+			unsigned sub = (unsigned)(value >> shift) & (SUB_BUCKETS - 1);
+
+			return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + sub;
+		}
+
+		/**
+		 * @return	highest value counted in the bucket
+		 */
+		static uint64_t value_of(unsigned index);
+
+		inline void record(uint64_t nanos)
+		{
+			_buckets[index_of(nanos)].fetch_add(1, std::memory_order_relaxed);
+			_count.fetch_add(1, std::memory_order_relaxed);
+			_sum.fetch_add(nanos, std::memory_order_relaxed);
+
+			uint64_t max = _max.load(std::memory_order_relaxed);
+			while (nanos > max && !_max.compare_exchange_weak(max, nanos, std::memory_order_relaxed));
+		}
+
+		inline void record(long long nanos)
+		{
+			record((uint64_t)(nanos > 0 ? nanos : 0));
+		}
+
+		void merge(const LatencyHistogram& other);
+		void clear();
+
+		/**
+		 * @param	ratio	portion of values that should be at or below the result
+		 * @return			upper bound of the bucket containing the percentile
+		 */
+		uint64_t percentile(double ratio) const;
+
+		inline uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+		inline uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+		inline uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+		inline double mean() const
+		{
+			uint64_t count = this->count();
+			return count ? (double)_sum.load(std::memory_order_relaxed) / (double)count : 0.0;
+		}
+
+		/**
+		 * @return	count, p50, p99, p99.9 and max on one line
+		 */
+		std::string to_string() const;
+
+		/**
+		 * @return	percentile distribution with one line per non-empty bucket
+		 */
+		std::string distribution() const;
+	};
+
+	/**
+	 * Histograms of every stage for every asset of a portfolio. They are
+	 * allocated up front and never move, so pointers to them stay valid.
+	 */
+	class LatencyTracker
+	{
+	private:
+		std::vector<LatencyHistogram> _histograms;
+
+	public:
+		LatencyTracker(unsigned assets = 0);
+
+		inline LatencyHistogram& histogram(unsigned asset, unsigned stage)
+		{
+			return _histograms[asset * STAGE_COUNT + stage];
+		}
+
+		inline const LatencyHistogram& histogram(unsigned asset, unsigned stage) const
+		{
+			return _histograms[asset * STAGE_COUNT + stage];
+		}
+
+		inline void record(unsigned asset, unsigned stage, long long nanos)
+		{
+			histogram(asset, stage).record(nanos);
+		}
+
+		/**
+		 * @return	histogram of a stage across every asset
+		 */
+		LatencyHistogram merged(unsigned stage) const;
+
+		inline unsigned assets() const { return _histograms.size() / STAGE_COUNT; }
+	};
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef DAYTRENDER_LOWLATENCY_H
+#define DAYTRENDER_LOWLATENCY_H
+
+// standard library
+#include <string>
+#include <thread>
+#include <vector>
+
+// microseconds spent spinning before a deadline if none is configured
+#define DEFAULT_SPIN_MICROS 200
+// bytes of stack touched up front so the hot loop never faults on it
+#define PREFAULT_STACK_SIZE (256 * 1024)
+// times pipeline stages poll their queues before sleeping in low latency mode
+#define LOW_LATENCY_SPIN_COUNT (1 << 16)
+
+namespace daytrender
+{
+	/**
+	 * Settings for the "low_latency" entry in portfolios.json
+	 */
+	struct LowLatencySettings
+	{
+		bool enabled = false;
+		// cores for the strategy evaluation threads, one thread per core
+		std::vector<int> evaluate_cores;
+		// cores that the execution threads of the portfolios take turns on
+		std::vector<int> execute_cores;
+		// core for the thread dispatching events, -1 to leave it unpinned
+		int dispatch_core = -1;
+		// how long before an event is due to stop sleeping and start spinning
+		unsigned spin_micros = DEFAULT_SPIN_MICROS;
+	};
+
+	/**
+	 * @return	an error message or nullptr on success
+	 */
+	const char *pin_thread(std::thread& thread, int core);
+	const char *pin_current_thread(int core);
+
+	/**
+	 * Locks all current and future pages of the process into memory and
+	 * touches the stack of the calling thread so it is mapped in.
+	 *
+	 * @return	an error message or nullptr on success
+	 */
+	const char *lock_memory();
+
+	/**
+	 * Distribution of how late wakeups were, kept in power of two buckets
+	 * so recording never allocates.
+	 */
+	class JitterStats
+	{
+	private:
+		static constexpr unsigned BUCKET_COUNT = 32;
+
+		unsigned long long _buckets[BUCKET_COUNT] = { 0 };
+		unsigned long long _count = 0;
+		long long _sum = 0;
+		long long _max = 0;
+
+	public:
+		/**
+		 * @param	late	microseconds between when a wakeup was due and when
+		 *					it happened
+		 */
+		void record(long long late);
+
+		/**
+		 * @param	ratio	portion of wakeups that should be at or below the result
+		 * @return			upper bound of the bucket containing the percentile
+		 */
+		long long percentile(double ratio) const;
+
+		inline unsigned long long count() const { return _count; }
+		inline long long max() const { return _max; }
+		inline double mean() const { return _count ? (double)_sum / (double)_count : 0.0; }
+
+		std::string to_string() const;
+	};
+}
+
+#endif
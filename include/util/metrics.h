@@ -0,0 +1,181 @@
+#ifndef DAYTRENDER_METRICS_H
+#define DAYTRENDER_METRICS_H
+
+// standard library
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace daytrender
+{
+	/**
+	 * Functions of a client plugin whose requests are counted
+	 */
+	enum ClientFunction
+	{
+		CLIENT_ACCOUNT,
+		CLIENT_PRICE_HISTORY,
+		CLIENT_POSITION,
+		CLIENT_QUOTE,
+		CLIENT_ORDER,
+		CLIENT_FUNCTION_COUNT
+	};
+
+	const char *client_function_name(unsigned function);
+
+	/**
+	 * Parts of the program that heap allocations are attributed to
+	 */
+	enum AllocSubsystem
+	{
+		ALLOC_OTHER,
+		ALLOC_CLIENT,
+		ALLOC_STRATEGY,
+		ALLOC_PORTFOLIO,
+		ALLOC_PIPELINE,
+		ALLOC_SERVER,
+		ALLOC_SUBSYSTEM_COUNT
+	};
+
+	const char *alloc_subsystem_name(unsigned subsystem);
+
+	/**
+	 * Counters kept by every thread. Durations are summed in nanoseconds.
+	 */
+	enum Metric
+	{
+		// one counter per client function for each of these
+		METRIC_CLIENT_REQUESTS,
+		METRIC_CLIENT_ERRORS = METRIC_CLIENT_REQUESTS + CLIENT_FUNCTION_COUNT,
+		METRIC_CLIENT_NANOS = METRIC_CLIENT_ERRORS + CLIENT_FUNCTION_COUNT,
+		METRIC_STRATEGY_EXECUTIONS = METRIC_CLIENT_NANOS + CLIENT_FUNCTION_COUNT,
+		METRIC_STRATEGY_NANOS,
+		METRIC_CANDLES_FETCHED,
+		// orders accepted and rejected by the broker
+		METRIC_ORDERS_PLACED,
+		METRIC_ORDERS_REJECTED,
+		// orders stopped by the pre-trade check before being sent
+		METRIC_ORDERS_BLOCKED,
+		// events dispatched and how late they were
+		METRIC_SCHEDULER_EVENTS,
+		METRIC_SCHEDULER_LAG_NANOS,
+		// requests admitted by the rate limiter and how long they waited
+		METRIC_RATE_LIMIT_ADMITTED,
+		METRIC_RATE_LIMIT_NANOS,
+		// one counter per subsystem for each of these, only while accounting
+		METRIC_ALLOCATIONS,
+		METRIC_ALLOCATED_BYTES = METRIC_ALLOCATIONS + ALLOC_SUBSYSTEM_COUNT,
+		// allocations made during a tick in steady state
+		METRIC_STEADY_STATE_ALLOCATIONS = METRIC_ALLOCATED_BYTES + ALLOC_SUBSYSTEM_COUNT,
+		METRIC_COUNT
+	};
+
+	/**
+	 * Counters of one thread. Only the owning thread writes to them, so
+	 * counting is a plain load and store that never contends, and they are
+	 * only summed up when metrics are scraped.
+	 */
+	struct alignas(64) MetricBlock
+	{
+		std::atomic<uint64_t> values[METRIC_COUNT];
+
+		MetricBlock()
+		{
+			for (std::atomic<uint64_t>& value : values) value.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * Hands a thread its block on first use and returns it to the registry
+	 * when the thread exits. Blocks keep their counts and are reused by the
+	 * next thread, so short lived threads don't grow the registry.
+	 */
+	class MetricHandle
+	{
+	private:
+		MetricBlock *_block;
+
+	public:
+		MetricHandle();
+		~MetricHandle();
+
+		inline MetricBlock& block() { return *_block; }
+	};
+
+	inline MetricBlock& thread_metrics()
+	{
+		static thread_local MetricHandle handle;
+		return handle.block();
+	}
+
+	inline void count_metric(Metric metric, uint64_t amount = 1)
+	{
+		std::atomic<uint64_t>& value = thread_metrics().values[metric];
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Counts a request made through a client plugin.
+	 *
+	 * @param	nanos	how long the request took
+	 * @param	failed	whether the plugin returned an error
+	 */
+	inline void count_request(ClientFunction function, long long nanos, bool failed)
+	{
+		count_metric((Metric)(METRIC_CLIENT_REQUESTS + function));
+		count_metric((Metric)(METRIC_CLIENT_NANOS + function), nanos > 0 ? nanos : 0);
+		if (failed) count_metric((Metric)(METRIC_CLIENT_ERRORS + function));
+	}
+
+	/**
+	 * Sums the counters of every thread that has counted anything.
+	 *
+	 * @param	out		array of METRIC_COUNT totals
+	 */
+	void collect_metrics(uint64_t *out);
+
+	/**
+	 * Values that only the latest update of a portfolio sets, read at scrape
+	 * time. They are shared by copies of the portfolio.
+	 */
+	struct PortfolioGauges
+	{
+		std::atomic<double> equity;
+		std::atomic<double> pl;
+		std::atomic<double> drawdown;
+
+		PortfolioGauges() : equity(0.0), pl(0.0), drawdown(0.0) {}
+	};
+
+	/**
+	 * Depth of a queue between pipeline stages at scrape time
+	 */
+	struct QueueMetrics
+	{
+		std::string portfolio;
+		const char *queue;
+		size_t depth;
+		size_t capacity;
+		size_t high_water;
+		size_t pushed;
+		size_t rejected;
+	};
+
+	/**
+	 * Heap statistics of the allocator, all in bytes
+	 */
+	struct AllocatorStats
+	{
+		bool ok = false;
+		// obtained from the system with sbrk
+		uint64_t arena = 0;
+		// obtained with mmap for large allocations
+		uint64_t mapped = 0;
+		uint64_t in_use = 0;
+		uint64_t free = 0;
+	};
+
+	AllocatorStats allocator_stats();
+}
+
+#endif
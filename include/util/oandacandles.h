@@ -0,0 +1,24 @@
+#ifndef DAYTRENDER_OANDACANDLES_H
+#define DAYTRENDER_OANDACANDLES_H
+
+// local includes
+#include <data/pricehistory.h>
+
+// standard library
+#include <string_view>
+
+namespace daytrender
+{
+	/**
+	 * Decodes the body of an Oanda candles response straight into the
+	 * history. It lives outside the plugin so that the benchmarks time the
+	 * same decoder the client uses.
+	 *
+	 * @param	hist	history to fill, whose size is the number of candles
+	 *					expected
+	 * @return	an error message or nullptr on success
+	 */
+	const char *decode_oanda_candles(std::string_view body, PriceHistory& hist);
+}
+
+#endif
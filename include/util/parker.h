@@ -0,0 +1,73 @@
+#ifndef DAYTRENDER_PARKER_H
+#define DAYTRENDER_PARKER_H
+
+// standard library
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// times a consumer polls before going to sleep
+#define PARKER_SPIN_COUNT 64
+// milliseconds a parked consumer sleeps before checking again on its own
+#define PARKER_TIMEOUT 10
+
+namespace daytrender
+{
+	/**
+	 * Lets the consumer of a ring buffer poll for a short while and then
+	 * sleep until a producer wakes it up. Producers only touch the mutex
+	 * when the consumer is actually asleep.
+	 */
+	class Parker
+	{
+	private:
+		std::mutex _mtx;
+		std::condition_variable _cv;
+		std::atomic<bool> _sleeping;
+		unsigned _spin = PARKER_SPIN_COUNT;
+
+	public:
+		Parker() : _sleeping(false) {}
+
+		/**
+		 * Sets how many times the consumer polls before sleeping. Should be
+		 * called before the consumer starts waiting.
+		 */
+		inline void set_spin(unsigned count) { _spin = count; }
+
+		/**
+		 * Blocks until ready returns true. A wake up that slips in between
+		 * the check and the sleep is caught by the timeout.
+		 */
+		template <typename Ready>
+		void wait(Ready ready)
+		{
+			for (unsigned i = 0; i < _spin; ++i)
+			{
+				if (ready()) return;
+				std::this_thread::yield();
+			}
+
+			std::unique_lock<std::mutex> lock(_mtx);
+			_sleeping.store(true);
+			while (!ready())
+			{
+				_cv.wait_for(lock, std::chrono::milliseconds(PARKER_TIMEOUT));
+			}
+			_sleeping.store(false, std::memory_order_relaxed);
+		}
+
+		void wake()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!_sleeping.load()) return;
+
+			std::lock_guard<std::mutex> lock(_mtx);
+			_cv.notify_one();
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef DAYTRENDER_RINGBUFFER_H
+#define DAYTRENDER_RINGBUFFER_H
+
+// standard library
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define CACHE_LINE_SIZE 64
+
+namespace daytrender
+{
+	inline size_t ring_capacity(size_t capacity)
+	{
+		size_t out = 2;
+		while (out < capacity) out <<= 1;
+		return out;
+	}
+
+	/**
+	 * Counters kept by the producers of a ring buffer so that queue depth
+	 * and backpressure can be observed from any thread.
+	 */
+	class RingMetrics
+	{
+	protected:
+		std::atomic<size_t> _pushed;
+		std::atomic<size_t> _rejected;
+		std::atomic<size_t> _high_water;
+
+		inline void record_push(size_t depth)
+		{
+			_pushed.fetch_add(1, std::memory_order_relaxed);
+			if (depth > _high_water.load(std::memory_order_relaxed))
+			{
+				_high_water.store(depth, std::memory_order_relaxed);
+			}
+		}
+
+		inline void record_full()
+		{
+			_rejected.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	public:
+		RingMetrics() : _pushed(0), _rejected(0), _high_water(0) {}
+
+		// values pushed successfully
+		inline size_t pushed() const { return _pushed.load(std::memory_order_relaxed); }
+		// pushes that failed because the buffer was full
+		inline size_t rejected() const { return _rejected.load(std::memory_order_relaxed); }
+		// largest depth seen after a push
+		inline size_t high_water() const { return _high_water.load(std::memory_order_relaxed); }
+	};
+
+	/**
+	 * Bounded lock-free queue for exactly one producer and one consumer
+	 * thread. Values are moved in and out; nothing is allocated after
+	 * construction.
+	 */
+	template <typename T>
+	class SpscRing : public RingMetrics
+	{
+	private:
+		typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+		std::unique_ptr<Slot[]> _slots;
+		size_t _mask;
+
+		// written by the consumer
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+		size_t _cached_tail = 0;
+		// written by the producer
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+		size_t _cached_head = 0;
+
+		inline T *slot(size_t pos) { return reinterpret_cast<T*>(&_slots[pos & _mask]); }
+
+	public:
+		SpscRing(size_t capacity) :
+		_slots(new Slot[ring_capacity(capacity)]),
+		_mask(ring_capacity(capacity) - 1),
+		_head(0),
+		_tail(0)
+		{}
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		~SpscRing()
+		{
+			T out;
+			while (pop(out));
+		}
+
+		bool push(T&& value)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _cached_head > _mask)
+			{
+				_cached_head = _head.load(std::memory_order_acquire);
+				if (tail - _cached_head > _mask)
+				{
+					record_full();
+					return false;
+				}
+			}
+
+			new (slot(tail)) T(std::move(value));
+			_tail.store(tail + 1, std::memory_order_release);
+			record_push(tail + 1 - _cached_head);
+
+			return true;
+		}
+
+		bool pop(T& out)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _cached_tail)
+			{
+				_cached_tail = _tail.load(std::memory_order_acquire);
+				if (head == _cached_tail) return false;
+			}
+
+			T *value = slot(head);
+			out = std::move(*value);
+			value->~T();
+			_head.store(head + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		inline size_t size() const
+		{
+			return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+		}
+
+		inline bool empty() const { return size() == 0; }
+		inline size_t capacity() const { return _mask + 1; }
+	};
+
+	/**
+	 * Bounded lock-free queue for any number of producer threads and one
+	 * consumer thread. Every slot carries a sequence number that tells
+	 * producers and the consumer whose turn it is.
+	 */
+	template <typename T>
+	class MpscRing : public RingMetrics
+	{
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+			inline T *value() { return reinterpret_cast<T*>(&storage); }
+		};
+
+		std::unique_ptr<Slot[]> _slots;
+		size_t _mask;
+
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+
+	public:
+		MpscRing(size_t capacity) :
+		_slots(new Slot[ring_capacity(capacity)]),
+		_mask(ring_capacity(capacity) - 1),
+		_head(0),
+		_tail(0)
+		{
+			for (size_t i = 0; i <= _mask; ++i)
+			{
+				_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MpscRing(const MpscRing&) = delete;
+		MpscRing& operator=(const MpscRing&) = delete;
+
+		~MpscRing()
+		{
+			T out;
+			while (pop(out));
+		}
+
+		bool push(T&& value)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			Slot *slot;
+
+			while (true)
+			{
+				slot = &_slots[tail & _mask];
+				size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)tail;
+
+				if (diff == 0)
+				{
+					// claiming the slot
+					if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) break;
+				}
+				else if (diff < 0)
+				{
+					// the consumer has not freed this slot yet
+					record_full();
+					return false;
+				}
+				else
+				{
+					tail = _tail.load(std::memory_order_relaxed);
+				}
+			}
+
+			new (slot->value()) T(std::move(value));
+			slot->sequence.store(tail + 1, std::memory_order_release);
+			record_push(tail + 1 - _head.load(std::memory_order_relaxed));
+
+			return true;
+		}
+
+		bool pop(T& out)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			Slot *slot = &_slots[head & _mask];
+
+			if (slot->sequence.load(std::memory_order_acquire) != head + 1) return false;
+
+			out = std::move(*slot->value());
+			slot->value()->~T();
+			slot->sequence.store(head + _mask + 1, std::memory_order_release);
+			_head.store(head + 1, std::memory_order_relaxed);
+
+			return true;
+		}
+
+		inline size_t size() const
+		{
+			size_t tail = _tail.load(std::memory_order_acquire);
+			size_t head = _head.load(std::memory_order_acquire);
+			return tail > head ? tail - head : 0;
+		}
+
+		inline bool empty() const { return size() == 0; }
+		inline size_t capacity() const { return _mask + 1; }
+	};
+}
+
+#endif
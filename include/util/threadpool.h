@@ -0,0 +1,71 @@
+#ifndef DAYTRENDER_THREADPOOL_H
+#define DAYTRENDER_THREADPOOL_H
+
+// standard library
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace daytrender
+{
+	/**
+	 * Fixed set of threads that run batches of indexed tasks. The thread
+	 * submitting a batch works on it as well and returns once every task
+	 * is done, so any number of threads can share one pool.
+	 */
+	class ThreadPool
+	{
+	private:
+		struct Batch
+		{
+			const std::function<void(unsigned)> *task;
+			unsigned count;
+			std::atomic<unsigned> next;
+			std::atomic<unsigned> done;
+
+			Batch(const std::function<void(unsigned)> *task, unsigned count) :
+			task(task),
+			count(count),
+			next(0),
+			done(0)
+			{}
+		};
+
+		std::vector<std::thread> _threads;
+		std::deque<std::shared_ptr<Batch>> _batches;
+		std::mutex _mtx;
+		std::condition_variable _work;
+		std::condition_variable _finished;
+		bool _running = true;
+
+		void run();
+		void work(Batch& batch);
+		void retire(const std::shared_ptr<Batch>& batch);
+
+	public:
+		/**
+		 * @param	threads	threads to start, 0 for one per core
+		 */
+		ThreadPool(unsigned threads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/**
+		 * Calls task with every index in [0, count) and blocks until all of
+		 * them have returned. Tasks may run in any order and on any thread.
+		 */
+		void run(unsigned count, const std::function<void(unsigned)>& task);
+
+		inline unsigned size() const { return _threads.size(); }
+		inline std::thread& thread(unsigned index) { return _threads[index]; }
+	};
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef DAYTRENDER_TRACE_H
+#define DAYTRENDER_TRACE_H
+
+// local includes
+#include <util/latency.h>
+
+// standard library
+#include <atomic>
+#include <string>
+
+// spans each thread keeps before the oldest are overwritten
+#define TRACE_RING_CAPACITY (1 << 14)
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Records the enclosing scope as a span on the timeline of the calling
+ * thread. The name must be a string literal. Defining DAYTRENDER_NO_TRACE
+ * compiles spans out entirely.
+ */
+#ifdef DAYTRENDER_NO_TRACE
+#define TRACE_SPAN(name)
+#else
+#define TRACE_SPAN(name) daytrender::TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#endif
+
+namespace daytrender
+{
+	extern std::atomic<bool> trace_flag;
+
+	inline bool is_tracing() { return trace_flag.load(std::memory_order_relaxed); }
+
+	/**
+	 * Starts or stops recording spans. Safe to call from a signal handler.
+	 */
+	inline void set_tracing(bool enabled) { trace_flag.store(enabled, std::memory_order_relaxed); }
+
+	/**
+	 * Adds a finished span to the ring of the calling thread.
+	 *
+	 * @param	start	monotonic nanoseconds at which the span started
+	 * @param	end		monotonic nanoseconds at which the span ended
+	 */
+	void trace_record(const char *name, long long start, long long end);
+
+	/**
+	 * Span that is recorded when it goes out of scope. While tracing is
+	 * disabled it costs checking a flag and never touches the clock.
+	 */
+	class TraceSpan
+	{
+	private:
+		const char *_name;
+		long long _start;
+
+	public:
+		inline TraceSpan(const char *name) :
+		_name(name),
+		_start(is_tracing() ? monotonic_nanos() : 0)
+		{}
+
+		inline ~TraceSpan()
+		{
+			if (_start) trace_record(_name, _start, monotonic_nanos());
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+	};
+
+	/**
+	 * @return	spans of every thread in the Chrome trace event format, which
+	 *			chrome://tracing and Perfetto can open
+	 */
+	std::string trace_json();
+
+	/**
+	 * @return	an error message or nullptr on success
+	 */
+	const char *write_trace(const std::string& filepath);
+
+	/**
+	 * Asks the trade loop to write a trace. Safe to call from a signal handler.
+	 */
+	void request_trace();
+
+	/**
+	 * @return	whether a trace was requested since the last call
+	 */
+	bool take_trace_request();
+}
+
+#endif
@@ -3,6 +3,10 @@
 // local includes
 #include <api/versions.h>
 #include <data/mathutil.h>
+#include <util/allocations.h>
+#include <util/asynclog.h>
+#include <util/metrics.h>
+#include <util/trace.h>
 
 // standard library
 #include <cstring>
@@ -21,6 +25,19 @@ using namespace hirzel;
 namespace daytrender
 {
 	std::unordered_map<std::string, std::shared_ptr<Plugin>> Client::_plugins;
+	std::unordered_map<std::string, std::shared_ptr<RequestScheduler>> Client::_schedulers;
+	// defined after the plugins so that refresh threads stop before plugins are freed
+	std::unordered_map<std::string, std::shared_ptr<SpreadEstimator>> Client::_spreads;
+	std::unordered_map<std::string, std::shared_ptr<Executor>> Client::_executors;
+	std::unordered_map<std::string, std::shared_ptr<OrderManager>> Client::_order_managers;
+
+	template <typename T>
+	static std::future<Result<T>> failed_future(const char *error)
+	{
+		std::promise<Result<T>> promise;
+		promise.set_value(error);
+		return promise.get_future();
+	}
 
 	Client::Client(const std::string& filename, const std::string& dir) :
 	_filename(filename)
@@ -47,12 +64,15 @@ namespace daytrender
 				"get_price_history",
 				"get_account",
 				"get_position",
+				"get_quote",
 				"market_order",
 				"secs_till_market_close",
 				"set_leverage",
 				"to_interval",
 				"key_count",
-				"max_candles"
+				"max_candles",
+				"rate_limit",
+				"rate_burst"
 			}))
 			{
 				ERROR(_plugin->error());
@@ -70,12 +90,56 @@ namespace daytrender
 		_get_account = (decltype(_get_account))_plugin->get_function("get_account");
 		_get_price_history = (decltype(_get_price_history))_plugin->get_function("get_price_history");
 		_get_position = (decltype(_get_position))_plugin->get_function("get_position");
+		_get_quote = (decltype(_get_quote))_plugin->get_function("get_quote");
 		_to_interval = (decltype(_to_interval))_plugin->get_function("to_interval");
 		_secs_till_market_close = (decltype(_secs_till_market_close))_plugin->get_function("secs_till_market_close");
 
 		_api_version = (decltype(_api_version))_plugin->get_function("api_version");
 		_key_count = (decltype(_key_count))_plugin->get_function("key_count");
 		_max_candles = (decltype(_max_candles))_plugin->get_function("max_candles");
+		_rate_limit = (decltype(_rate_limit))_plugin->get_function("rate_limit");
+		_rate_burst = (decltype(_rate_burst))_plugin->get_function("rate_burst");
+
+		// every client using the same plugin shares its connection and rate limits
+		_scheduler = _schedulers[filename];
+		if (!_scheduler)
+		{
+			_scheduler = std::make_shared<RequestScheduler>(_rate_limit(), _rate_burst());
+			_schedulers[filename] = _scheduler;
+		}
+
+		_spread = _spreads[filename];
+		if (!_spread)
+		{
+			// quotes are refreshed at the lowest priority so they never delay orders
+			std::shared_ptr<Plugin> plugin = _plugin;
+			std::shared_ptr<RequestScheduler> scheduler = _scheduler;
+			auto get_quote = _get_quote;
+			_spread = std::make_shared<SpreadEstimator>([plugin, scheduler, get_quote](double *price, double *spread, const char *ticker)
+			{
+				scheduler->acquire(PRIORITY_HISTORY);
+				long long start = monotonic_nanos();
+				const char *error = get_quote(price, spread, ticker);
+				count_request(CLIENT_QUOTE, monotonic_nanos() - start, error);
+				return error;
+			});
+			_spreads[filename] = _spread;
+		}
+
+		_io = _executors[filename];
+		if (!_io)
+		{
+			_io = std::make_shared<Executor>(CLIENT_IO_THREADS, PRIORITY_COUNT);
+			_executors[filename] = _io;
+		}
+
+		// every client using the same plugin trades on the same account
+		_orders = _order_managers[filename];
+		if (!_orders)
+		{
+			_orders = std::make_shared<OrderManager>();
+			_order_managers[filename] = _orders;
+		}
 	}
 
 	const char *Client::init(const hirzel::Data& keys)
@@ -110,6 +174,8 @@ namespace daytrender
 	Result<PriceHistory> Client::get_price_history(const std::string& ticker,
 		unsigned interval, unsigned count) const
 	{
+		TRACE_SPAN("Client::get_price_history");
+		ALLOCATION_SCOPE(ALLOC_CLIENT);
 		cli_func_check();
 
 		if (count == 0)
@@ -120,54 +186,210 @@ namespace daytrender
 		{
 			return "requested more candles than maximum";
 		}
-		PriceHistory hist(count, interval);
-		const char *error = _get_price_history(&hist, ticker.c_str());
-		if (error) return error;
-		return hist;
+		std::string key = "history:" + ticker + ":" + std::to_string(interval)
+			+ ":" + std::to_string(count);
+
+		return _scheduler->coalesce<PriceHistory>(key, PRIORITY_HISTORY, [&]() -> Result<PriceHistory>
+		{
+			PriceHistory hist(count, interval);
+			long long start = monotonic_nanos();
+			const char *error = _get_price_history(&hist, ticker.c_str());
+			count_request(CLIENT_PRICE_HISTORY, monotonic_nanos() - start, error);
+			if (error) return error;
+			count_metric(METRIC_CANDLES_FETCHED, hist.size());
+			return hist;
+		});
 	}
 
-	Result<Account> Client::get_account() const
+	std::future<Result<Account>> Client::get_account_async(RequestPriority priority) const
 	{
+		if (!_io) return failed_future<Account>("client is not bound");
+
+		return _io->submit(priority, [this, priority]()
+		{
+			return get_account(priority);
+		});
+	}
+
+	std::future<Result<PriceHistory>> Client::get_price_history_async(const Asset& asset,
+		LatencyHistogram *latency) const
+	{
+		if (!_io) return failed_future<PriceHistory>("client is not bound");
+
+		std::string ticker = asset.ticker();
+		unsigned interval = asset.interval();
+		unsigned count = asset.candle_count();
+		// the request runs on an io thread, which is part of the tick that made it
+		bool tick = in_tick();
+
+		// bulk history pulls queue behind orders and account requests
+		return _io->submit(PRIORITY_HISTORY, [this, ticker, interval, count, latency, tick]()
+		{
+			AllocationScope scope(ALLOC_CLIENT, tick);
+			long long start = monotonic_nanos();
+			Result<PriceHistory> res = get_price_history(ticker, interval, count);
+			if (latency) latency->record(monotonic_nanos() - start);
+			return res;
+		});
+	}
+
+	std::future<Result<Position>> Client::get_position_async(const std::string& ticker,
+		RequestPriority priority) const
+	{
+		if (!_io) return failed_future<Position>("client is not bound");
+
+		return _io->submit(priority, [this, ticker, priority]()
+		{
+			return get_position(ticker, priority);
+		});
+	}
+
+	std::future<Result<Fill>> Client::market_order_async(const std::string& ticker, double amount,
+		RequestPriority priority)
+	{
+		if (!_io) return failed_future<Fill>("client is not bound");
+
+		return _io->submit(priority, [this, ticker, amount, priority]()
+		{
+			return market_order(ticker, amount, priority);
+		});
+	}
+
+	Result<Account> Client::get_account(RequestPriority priority) const
+	{
+		TRACE_SPAN("Client::get_account");
+		ALLOCATION_SCOPE(ALLOC_CLIENT);
 		cli_func_check();
-		Account account;
-		const char *error = _get_account(&account);
-		if (error) return error;
-		return account;
+
+		return _scheduler->coalesce<Account>("account", priority, [&]() -> Result<Account>
+		{
+			Account account;
+			long long start = monotonic_nanos();
+			const char *error = _get_account(&account);
+			count_request(CLIENT_ACCOUNT, monotonic_nanos() - start, error);
+			if (error) return error;
+			return account;
+		});
 	}
 
 	/**
 	 * Places an immediately returning order on the market. If the amount
-	 * is set to zero, it'll return true and not place an order. If the amount
-	 * is positive, it'll place a long order and a short order if the shares
-	 * are negative.
+	 * is set to zero, it'll return an empty fill and not place an order. If
+	 * the amount is positive, it'll place a long order and a short order if
+	 * the shares are negative. The fill is applied to the local position book.
 	 * 
-	 * @param	ticker	the symbol that the client should place the order for
-	 * @param	amount	the amount of shares the client should order
-	 * @return			a bool representing success or failure of the function
+	 * @param	ticker		the symbol that the client should place the order for
+	 * @param	amount		the amount of shares the client should order
+	 * @param	priority	the priority the order is sent with
+	 * @return				the fill or an error message
 	 */
-	const char *Client::market_order(const std::string& ticker, double amount)
+	Result<Fill> Client::market_order(const std::string& ticker, double amount,
+		RequestPriority priority)
 	{
+		TRACE_SPAN("Client::market_order");
+		ALLOCATION_SCOPE(ALLOC_CLIENT);
 		cli_func_check();
-		if (amount == 0.0) return nullptr;
-		return _market_order(ticker.c_str(), amount);
+		if (amount == 0.0) return Fill();
+
+		unsigned long long id = _orders->submit(ticker, amount);
+		_scheduler->acquire(priority);
+		Fill fill;
+		long long start = monotonic_nanos();
+		const char *error = _market_order(&fill, ticker.c_str(), amount);
+		count_request(CLIENT_ORDER, monotonic_nanos() - start, error);
+		count_metric(error ? METRIC_ORDERS_REJECTED : METRIC_ORDERS_PLACED);
+		// account and position requests from before the order are now stale
+		_scheduler->invalidate();
+
+		if (error)
+		{
+			_orders->reject(id, error);
+			return error;
+		}
+
+		_orders->fill(id, fill);
+		return fill;
 	}
 
-	Result<Position> Client::get_position(const std::string& ticker) const
+	Result<Position> Client::get_position(const std::string& ticker,
+		RequestPriority priority) const
 	{
+		TRACE_SPAN("Client::get_position");
+		ALLOCATION_SCOPE(ALLOC_CLIENT);
 		cli_func_check();
 
-		Position position;
-		const char *error = _get_position(&position, ticker.c_str());
-		if (error) return error;
-		return position;
+		// fee comes from the cached spread estimate, as does the price if the
+		// broker does not report one with the position. Only an instrument the
+		// background hasn't quoted yet waits for a quote.
+		double price = 0.0, fee = 0.0;
+		bool estimated = _spread->get(ticker, price, fee);
+		if (!estimated) estimated = quote(ticker, price, fee);
+
+		// the local book answers without a request while it is trusted, and
+		// there is a price to go with it
+		BookPosition book;
+		if (estimated && _orders->position(ticker, book))
+		{
+			return Position(std::abs(book.shares) * book.avg_price, fee, book.minimum,
+				price, book.shares);
+		}
+
+		unsigned long long version = _orders->version(ticker);
+		Result<Position> res = _scheduler->coalesce<Position>("position:" + ticker, priority,
+			[&]() -> Result<Position>
+		{
+			Position position;
+			long long start = monotonic_nanos();
+			const char *error = _get_position(&position, ticker.c_str());
+			count_request(CLIENT_POSITION, monotonic_nanos() - start, error);
+			if (error) return error;
+			return position;
+		});
+
+		if (!res) return res;
+		Position pos = res.get();
+
+		double avg_price = pos.shares() != 0.0 ? pos.amt_invested() / std::abs(pos.shares()) : 0.0;
+		_orders->reconcile(ticker, pos.shares(), avg_price, pos.minimum(), version);
+
+		if (pos.price() > 0.0) price = pos.price();
+
+		return Position(pos.amt_invested(), fee, pos.minimum(), price, pos.shares());
 	}
 
-	const char *Client::close_position(const Asset& asset)
+	/**
+	 * Quotes an instrument at order priority, as an order can be waiting on
+	 * the price, and adds the quote to its spread estimate.
+	 *
+	 * @return	false if the quote failed, in which case price and fee are 0
+	 */
+	bool Client::quote(const std::string& ticker, double& price, double& fee) const
+	{
+		double spread = 0.0;
+		_scheduler->acquire(PRIORITY_ORDER);
+		long long start = monotonic_nanos();
+		const char *error = _get_quote(&price, &spread, ticker.c_str());
+		count_request(CLIENT_QUOTE, monotonic_nanos() - start, error);
+
+		if (!error && price <= 0.0) error = "quote price was not positive";
+		if (error)
+		{
+			WARNING("Failed to quote $%s: %s", ticker, error);
+			price = fee = 0.0;
+			return false;
+		}
+
+		fee = _spread->record(ticker, price, spread);
+		return true;
+	}
+
+	const char *Client::close_position(const Asset& asset, RequestPriority priority)
 	{
-		Result<Position> res = get_position(asset.ticker());
+		Result<Position> res = get_position(asset.ticker(), priority);
 		if (!res) return res.error();
 		Position pos = res.get();
-		return market_order(asset.ticker(), -pos.shares());
+		Result<Fill> fill = market_order(asset.ticker(), -pos.shares(), priority);
+		return fill ? nullptr : fill.error();
 	}
 
 	const char *Client::close_all_positions(const std::vector<Asset>& assets)
@@ -175,7 +397,7 @@ namespace daytrender
 		bool failed = false;
 		for (const Asset& a : assets)
 		{
-			const char *error = close_position(a);
+			const char *error = close_position(a, PRIORITY_CLOSEOUT);
 			if (error)
 			{
 				failed = true;
@@ -186,22 +408,41 @@ namespace daytrender
 	}
 
 	const char *Client::enter_position(const Asset& asset, double pct, bool short_shares)
+	{
+		Result<double> res = shares_to_enter(asset, pct, short_shares);
+		if (!res) return res.error();
+		double shares = res.get();
+
+		ASYNC_DEBUG("Placing order for %f shares!!!", shares);
+		
+		Result<Fill> fill = market_order(asset.ticker(), shares);
+		return fill ? nullptr : fill.error();
+	}
+
+	Result<double> Client::shares_to_enter(const Asset& asset, double pct, bool short_shares,
+		const std::function<double(double, double)>& limit) const
 	{
 		// if not buying anything, exit
-		if (asset.risk() == 0.0) return nullptr;
+		if (asset.risk() == 0.0) return 0.0;
 
 		// will be -1.0 if short_shares is true or 1.0 if it's false
 		double multiplier = (double)short_shares * -2.0 + 1.0;
 
+		// account and position are requested at the same time
+		std::future<Result<Account>> acc_future = get_account_async();
+
+		// get position information
+		Result<Position> pos_res = get_position(asset.ticker());
+
 		// getting current account information
-		Result<Account> acc_res = get_account();
+		Result<Account> acc_res = acc_future.get();
 		if (!acc_res) return acc_res.error();
 		Account acc = acc_res.get();
 
-		// get position information
-		Result<Position> pos_res = get_position(asset.ticker());
 		if (!pos_res) return pos_res.error();
 		Position pos = pos_res.get();
+		// the broker didn't report one and the instrument isn't quoted yet
+		if (pos.price() <= 0.0) return "no price is known for the instrument yet";
 
 
 		// pct should equal _risk / risk_sum()
@@ -222,10 +463,24 @@ namespace daytrender
 			buying_power += pos.shares() * pos.price() * (1.0 - multiplier * pos.fee());
 		}
 
-		double shares = multiplier * std::floor(((buying_power / (1.0 + pos.fee())) / pos.price()) / pos.minimum()) * pos.minimum();
-		DEBUG("Placing order for %f shares!!!", shares);
-		
-		return market_order(asset.ticker(), shares);
+		double shares = multiplier * (buying_power / (1.0 + pos.fee())) / pos.price();
+		if (limit) shares = limit(shares, pos.price());
+
+		return std::trunc(shares / pos.minimum()) * pos.minimum();
+	}
+
+	double Client::target_shares(const Asset& asset, double pct, bool short_shares,
+		const Account& acc, const Position& pos) const
+	{
+		if (asset.risk() == 0.0 || pos.price() <= 0.0) return 0.0;
+
+		double multiplier = (double)short_shares * -2.0 + 1.0;
+
+		// buying power and margin used together stay the same however the
+		// account is currently invested
+		double buying_power = (acc.buying_power() + acc.margin_used()) * asset.risk() * pct;
+
+		return multiplier * (buying_power / (1.0 + pos.fee())) / pos.price();
 	}
 
 	
@@ -242,6 +497,7 @@ namespace daytrender
 		if (pos.shares() * multiplier <= 0.0) return nullptr;
 
 		// exit position
-		return market_order(asset.ticker(), -pos.shares());
+		Result<Fill> fill = market_order(asset.ticker(), -pos.shares());
+		return fill ? nullptr : fill.error();
 	}
 }
\ No newline at end of file
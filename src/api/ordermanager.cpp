@@ -0,0 +1,145 @@
+#include <api/ordermanager.h>
+
+// standard library
+#include <cmath>
+
+// external libraries
+#include <hirzel/logger.h>
+#include <hirzel/util/sys.h>
+
+namespace daytrender
+{
+	Order *OrderManager::find(unsigned long long id)
+	{
+		// ids are increasing so the order can be found by its distance from the back
+		if (_orders.empty() || id > _orders.back().id) return nullptr;
+
+		unsigned long long offset = _orders.back().id - id;
+		if (offset >= _orders.size()) return nullptr;
+
+		return &_orders[_orders.size() - 1 - offset];
+	}
+
+	unsigned long long OrderManager::submit(const std::string& ticker, double shares)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		unsigned long long id = _next_id++;
+		_orders.push_back({ id, ticker, shares, ORDER_PENDING, Fill(), nullptr,
+			hirzel::sys::epoch_seconds() });
+		BookPosition& pos = _book[ticker];
+		pos.pending += 1;
+		pos.version += 1;
+
+		// dropping finished orders from the front
+		while (_orders.size() > ORDER_HISTORY_SIZE && _orders.front().status != ORDER_PENDING)
+		{
+			_orders.pop_front();
+		}
+
+		return id;
+	}
+
+	void OrderManager::fill(unsigned long long id, const Fill& fill)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		Order *order = find(id);
+		if (!order) return;
+
+		order->status = ORDER_FILLED;
+		order->fill = fill;
+
+		BookPosition& pos = _book[order->ticker];
+		pos.pending -= 1;
+
+		double shares = pos.shares;
+		double filled = fill.shares();
+
+		if (shares * filled >= 0.0)
+		{
+			// opening or adding to a position
+			double total = std::abs(shares) + std::abs(filled);
+			if (total > 0.0)
+			{
+				pos.avg_price = (pos.avg_price * std::abs(shares) + fill.price() * std::abs(filled)) / total;
+			}
+		}
+		else if (std::abs(filled) > std::abs(shares))
+		{
+			// flipping to the other side
+			pos.avg_price = fill.price();
+		}
+
+		pos.shares = shares + filled;
+		if (pos.shares == 0.0) pos.avg_price = 0.0;
+		pos.fees += fill.fee();
+	}
+
+	void OrderManager::reject(unsigned long long id, const char *error)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		Order *order = find(id);
+		if (!order) return;
+
+		order->status = ORDER_REJECTED;
+		order->error = error;
+
+		BookPosition& pos = _book[order->ticker];
+		pos.pending -= 1;
+		pos.reconciled = 0;
+	}
+
+	bool OrderManager::position(const std::string& ticker, BookPosition& out) const
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		auto iter = _book.find(ticker);
+		if (iter == _book.end()) return false;
+
+		const BookPosition& pos = iter->second;
+		if (pos.pending > 0 || pos.reconciled == 0) return false;
+		if (hirzel::sys::epoch_seconds() - pos.reconciled >= ORDER_RECONCILE_INTERVAL) return false;
+
+		out = pos;
+		return true;
+	}
+
+	unsigned long long OrderManager::version(const std::string& ticker) const
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		auto iter = _book.find(ticker);
+		return iter == _book.end() ? 0 : iter->second.version;
+	}
+
+	void OrderManager::reconcile(const std::string& ticker, double shares, double avg_price,
+		double minimum, unsigned long long version)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+
+		BookPosition& pos = _book[ticker];
+
+		// the broker may not have seen orders sent while it was being asked
+		if (pos.pending > 0 || pos.version != version) return;
+
+		if (pos.reconciled > 0 && std::abs(pos.shares - shares) > 1e-9)
+		{
+			WARNING("$%s: local position of %f shares did not match broker's %f",
+				ticker, pos.shares, shares);
+		}
+
+		pos.shares = shares;
+		pos.avg_price = avg_price;
+		pos.fees = 0.0;
+		pos.minimum = minimum;
+		pos.reconciled = hirzel::sys::epoch_seconds();
+	}
+
+	std::vector<Order> OrderManager::orders() const
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		return std::vector<Order>(_orders.begin(), _orders.end());
+	}
+}
@@ -0,0 +1,80 @@
+#include <api/scheduler.h>
+
+// local includes
+#include <util/latency.h>
+#include <util/metrics.h>
+
+namespace daytrender
+{
+	RequestScheduler::RequestScheduler(unsigned rate, unsigned burst) :
+	_rate(rate),
+	_burst(burst > 0 ? burst : rate),
+	_last_refill(std::chrono::steady_clock::now())
+	{
+		_tokens = _burst;
+		_reserve = (double)(unsigned)(_burst / 4.0);
+	}
+
+	void RequestScheduler::refill()
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed = now - _last_refill;
+		_last_refill = now;
+
+		_tokens += elapsed.count() * _rate;
+		if (_tokens > _burst) _tokens = _burst;
+	}
+
+	void RequestScheduler::acquire(RequestPriority priority)
+	{
+		// no limit was declared by the plugin
+		if (_rate <= 0.0) return;
+
+		long long start = monotonic_nanos();
+		std::unique_lock<std::mutex> lock(_mtx);
+		_waiting[priority] += 1;
+
+		// bulk data pulls leave a reserve in the bucket for everything else
+		double needed = (priority == PRIORITY_HISTORY) ? 1.0 + _reserve : 1.0;
+
+		while (true)
+		{
+			refill();
+
+			bool outranked = false;
+			for (unsigned i = 0; i < priority; ++i)
+			{
+				if (_waiting[i] > 0)
+				{
+					outranked = true;
+					break;
+				}
+			}
+
+			if (!outranked && _tokens >= needed)
+			{
+				_tokens -= 1.0;
+				_waiting[priority] -= 1;
+				break;
+			}
+
+			// sleep until enough tokens should have accumulated
+			double deficit = needed - _tokens;
+			if (deficit < 1.0) deficit = 1.0;
+			_cv.wait_for(lock, std::chrono::duration<double>(deficit / _rate));
+		}
+
+		lock.unlock();
+		// lower priorities may be able to go now
+		_cv.notify_all();
+
+		count_metric(METRIC_RATE_LIMIT_ADMITTED);
+		count_metric(METRIC_RATE_LIMIT_NANOS, monotonic_nanos() - start);
+	}
+
+	void RequestScheduler::invalidate()
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		_generation += 1;
+	}
+}
@@ -0,0 +1,142 @@
+#include <api/spreadestimator.h>
+
+// standard library
+#include <chrono>
+#include <vector>
+
+// external libraries
+#include <hirzel/logger.h>
+
+namespace daytrender
+{
+	static long long steady_seconds()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	SpreadEstimator::SpreadEstimator(QuoteFunction quote) :
+	_quote(quote)
+	{}
+
+	SpreadEstimator::~SpreadEstimator()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		_running = false;
+		lock.unlock();
+		_cv.notify_all();
+
+		if (_thread.joinable()) _thread.join();
+	}
+
+	const char *SpreadEstimator::update(const std::string& ticker)
+	{
+		double price = 0.0, spread = 0.0;
+		const char *error = _quote(&price, &spread, ticker.c_str());
+		if (error) return error;
+		if (price <= 0.0) return "quote price was not positive";
+
+		record(ticker, price, spread);
+
+		return nullptr;
+	}
+
+	double SpreadEstimator::record(const std::string& ticker, double price, double spread)
+	{
+		double fee = spread / (price * 2.0);
+
+		std::lock_guard<std::mutex> lock(_mtx);
+		Estimate& est = _estimates[ticker];
+
+		if (est.updated == 0)
+		{
+			est.fee = fee;
+		}
+		else
+		{
+			est.fee = SPREAD_EWMA_ALPHA * fee + (1.0 - SPREAD_EWMA_ALPHA) * est.fee;
+		}
+
+		est.price = price;
+		est.updated = steady_seconds();
+
+		return est.fee;
+	}
+
+	void SpreadEstimator::start()
+	{
+		if (_running) return;
+
+		_running = true;
+		_thread = std::thread(&SpreadEstimator::refresh, this);
+	}
+
+	void SpreadEstimator::refresh()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		while (_running)
+		{
+			// gathering tickers that are due so quotes are fetched without the lock
+			long long now = steady_seconds();
+			std::vector<std::string> due;
+			for (const auto& pair : _estimates)
+			{
+				if (now - pair.second.updated >= SPREAD_REFRESH_INTERVAL) due.push_back(pair.first);
+			}
+
+			lock.unlock();
+			for (const std::string& ticker : due)
+			{
+				const char *error = update(ticker);
+				if (error) WARNING("failed to refresh spread of $%s: %s", ticker, error);
+			}
+			lock.lock();
+
+			_cv.wait_for(lock, std::chrono::seconds(1));
+		}
+	}
+
+	bool SpreadEstimator::get(const std::string& ticker, double& price, double& fee)
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+
+		// the background refresh starts with the first instrument
+		start();
+
+		auto iter = _estimates.find(ticker);
+		if (iter == _estimates.end())
+		{
+			// a new instrument is due right away, so it is quoted on the next pass
+			_estimates[ticker] = Estimate();
+			lock.unlock();
+			_cv.notify_all();
+
+			price = fee = 0.0;
+			return false;
+		}
+
+		const Estimate& est = iter->second;
+		if (est.updated == 0 || steady_seconds() - est.updated > SPREAD_MAX_AGE)
+		{
+			price = fee = 0.0;
+			return false;
+		}
+
+		price = est.price;
+		fee = est.fee;
+
+		return true;
+	}
+
+	void SpreadEstimator::track(const std::string& ticker)
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		start();
+
+		// a new instrument is due right away
+		if (_estimates.count(ticker)) return;
+		_estimates[ticker] = Estimate();
+		lock.unlock();
+		_cv.notify_all();
+	}
+}
@@ -2,6 +2,8 @@
 
 // local includes
 #include <api/versions.h>
+#include <util/allocations.h>
+#include <util/trace.h>
 
 // standard library
 #include <unordered_map>
@@ -19,6 +21,7 @@ using hirzel::Plugin;
 namespace daytrender
 {
 	std::unordered_map<std::string, std::shared_ptr<Plugin>> Strategy::_plugins;
+	std::unordered_map<std::string, std::shared_ptr<std::mutex>> Strategy::_locks;
 
 	Strategy::Strategy(const std::string& filename, const std::string& dir) :
 	_filename(filename)
@@ -41,12 +44,16 @@ namespace daytrender
 				"indicator_count",
 				"data_length",
 				"execute",
-				"api_version"
+				"api_version",
+				"is_reentrant"
 			}))
 			{
 				throw _plugin->error();
 			}
 
+			// plugins built before it was added don't export it
+			_plugin->bind_functions({ "execute_indicator" });
+
 			_plugins[filename] = _plugin;
 		}
 
@@ -60,6 +67,18 @@ namespace daytrender
 		_indicator_count = _plugin->execute<uint32_t>("indicator_count");
 		_data_length = _plugin->execute<uint32_t>("data_length");
 		_execute = (decltype(_execute))_plugin->get_function("execute");
+		_execute_indicator = (decltype(_execute_indicator))_plugin->get_function("execute_indicator");
+
+		// every asset using the plugin has to share the same lock
+		if (!_plugin->execute<uint32_t>("is_reentrant"))
+		{
+			_lock = _locks[filename];
+			if (!_lock)
+			{
+				_lock = std::make_shared<std::mutex>();
+				_locks[filename] = _lock;
+			}
+		}
 	}
 
 
@@ -73,15 +92,40 @@ namespace daytrender
 	Chart Strategy::execute(const PriceHistory& candles,
 		const std::vector<int>& ranges) const
 	{
+		TRACE_SPAN("Strategy::execute");
+		ALLOCATION_SCOPE(ALLOC_STRATEGY);
 		if (!_execute) throw _filename + ": execute function is not bound";
 		// create chart data
 		Chart data(ranges, candles, _data_length);
 
 		// execute the strategy
-		const char *error = _execute(&data);
+		const char *error;
+		if (_lock)
+		{
+			std::lock_guard<std::mutex> lock(*_lock);
+			error = _execute(&data);
+		}
+		else
+		{
+			error = _execute(&data);
+		}
 
 		if (error) throw _filename + ": " + std::string(error);
 
 		return data;
 	}
+
+
+	const char *Strategy::execute_indicator(Chart& chart, unsigned index) const
+	{
+		if (!_execute_indicator) return "strategy does not export execute_indicator";
+
+		if (_lock)
+		{
+			std::lock_guard<std::mutex> lock(*_lock);
+			return _execute_indicator(&chart, index);
+		}
+
+		return _execute_indicator(&chart, index);
+	}
 }
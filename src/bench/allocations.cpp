@@ -0,0 +1,31 @@
+// local includes
+#include <util/allocations.h>
+#include <util/benchmark.h>
+
+// standard library
+#include <memory>
+
+using namespace daytrender;
+
+// with accounting off the hook is a flag check in front of malloc
+BENCHMARK(allocation_unaccounted)
+{
+	set_allocation_accounting(false);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		std::unique_ptr<int> ptr(new int((int)i));
+		bench_keep(ptr);
+	}
+}
+
+BENCHMARK(allocation_accounted)
+{
+	set_allocation_accounting(true);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		ALLOCATION_SCOPE(ALLOC_STRATEGY);
+		std::unique_ptr<int> ptr(new int((int)i));
+		bench_keep(ptr);
+	}
+	set_allocation_accounting(false);
+}
@@ -0,0 +1,44 @@
+// local includes
+#include <data/chart.h>
+#include <data/pricehistory.h>
+#include <util/benchmark.h>
+
+// standard library
+#include <vector>
+
+#define HISTORY_SIZE 35
+#define DATA_LENGTH 5
+
+using namespace daytrender;
+
+BENCHMARK(chart_construct)
+{
+	std::vector<int> ranges = { 30, 10 };
+	PriceHistory hist = bench_candles(HISTORY_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Chart chart(ranges, hist, DATA_LENGTH);
+		bench_keep(chart);
+	}
+}
+
+BENCHMARK(indicator_construct)
+{
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Indicator indicator(DATA_LENGTH);
+		bench_keep(indicator);
+	}
+}
+
+BENCHMARK(indicator_copy)
+{
+	Indicator source(DATA_LENGTH);
+	for (unsigned i = 0; i < DATA_LENGTH; ++i) source[i] = (double)i;
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Indicator indicator(source);
+		bench_keep(indicator);
+	}
+}
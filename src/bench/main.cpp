@@ -0,0 +1,350 @@
+// local includes
+#include <util/benchmark.h>
+#include <util/jsonreader.h>
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// external libraries
+#include <hirzel/logger.h>
+
+using namespace daytrender;
+
+#ifdef NDEBUG
+#define BENCH_BUILD "release"
+#else
+#define BENCH_BUILD "debug"
+#endif
+
+// default slowdown over the baseline that is still accepted
+#define BENCH_TOLERANCE 0.1
+// median absolute deviations of noise allowed on top of the tolerance
+#define BENCH_NOISE_MADS 3.0
+// exit status ctest reports as skipped
+#define BENCH_SKIPPED 77
+
+struct BenchReport
+{
+	unsigned long long iterations = 0;
+	double median = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	// median absolute deviation of the samples
+	double mad = 0.0;
+	double items_per_sec = 0.0;
+	const char *unit = "ops";
+	const char *status = "ok";
+	std::string reason;
+	// median of the baseline, 0 if there is none
+	double baseline = 0.0;
+};
+
+struct Baseline
+{
+	std::string build;
+	std::unordered_map<std::string, BenchReport> reports;
+};
+
+static double time_run(const BenchCase& bench, BenchState& state)
+{
+	auto start = std::chrono::steady_clock::now();
+	bench.func(state);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static BenchReport run(const BenchCase& bench, unsigned samples)
+{
+	BenchReport report;
+
+	// growing the iterations until a sample takes long enough to time reliably
+	unsigned long long iterations = 1;
+	while (true)
+	{
+		BenchState state(iterations);
+		double elapsed = time_run(bench, state);
+
+		if (state.skipped())
+		{
+			report.status = "skipped";
+			report.reason = state.skip_reason();
+			return report;
+		}
+
+		if (elapsed >= BENCH_SAMPLE_NANOS) break;
+
+		double growth = elapsed > 0.0 ? BENCH_SAMPLE_NANOS * 1.2 / elapsed : 100.0;
+		growth = std::min(std::max(growth, 2.0), 100.0);
+		iterations = (unsigned long long)(iterations * growth);
+	}
+
+	std::vector<double> times(samples);
+	BenchState state(iterations);
+	for (double& time : times)
+	{
+		time = time_run(bench, state) / (double)iterations;
+	}
+	std::sort(times.begin(), times.end());
+
+	report.iterations = iterations;
+	report.median = times[times.size() / 2];
+	report.min = times.front();
+	report.max = times.back();
+
+	std::vector<double> deviations;
+	for (double time : times) deviations.push_back(std::abs(time - report.median));
+	std::sort(deviations.begin(), deviations.end());
+	report.mad = deviations[deviations.size() / 2];
+
+	report.items_per_sec = state.items() * 1e9 / report.median;
+	report.unit = state.unit();
+
+	if (bench.budget > 0.0 && report.median > bench.budget) report.status = "over_budget";
+
+	return report;
+}
+
+/**
+ * Reads the json lines written by --json or --record.
+ *
+ * @return	false if the file couldn't be read
+ */
+static bool read_baseline(Baseline& out, const char *filepath)
+{
+	std::ifstream file(filepath);
+	if (!file) return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		JsonReader json(line);
+		if (json.next() != JSON_OBJECT) continue;
+
+		std::string name;
+		BenchReport report;
+		JsonToken token;
+		while ((token = json.next()) == JSON_KEY)
+		{
+			if (json.equals("context"))
+			{
+				if (json.next() != JSON_OBJECT || !json.find("build") || json.next() != JSON_STRING) break;
+				out.build = std::string(json.view());
+				break;
+			}
+
+			std::string key(json.view());
+			token = json.next();
+			if (key == "benchmark") name = std::string(json.view());
+			else if (key == "median_ns") report.median = json.to_double();
+			else if (key == "mad_ns") report.mad = json.to_double();
+			else if (token == JSON_OBJECT || token == JSON_ARRAY) break;
+		}
+
+		if (!name.empty() && report.median > 0.0) out.reports[name] = report;
+	}
+
+	return true;
+}
+
+/**
+ * @return	slowest median time per operation that isn't a regression
+ */
+static double regression_limit(const BenchReport& baseline, const BenchReport& report,
+	double tolerance)
+{
+	return baseline.median * (1.0 + tolerance) + BENCH_NOISE_MADS * std::max(baseline.mad, report.mad);
+}
+
+static void print_json(FILE *out, const BenchCase& bench, unsigned samples, const BenchReport& report)
+{
+	if (!report.reason.empty())
+	{
+		fprintf(out, "{\"benchmark\":\"%s\",\"status\":\"%s\",\"reason\":\"%s\"}\n",
+			bench.name, report.status, report.reason.c_str());
+		return;
+	}
+
+	fprintf(out, "{\"benchmark\":\"%s\",\"status\":\"%s\",\"iterations\":%llu,\"samples\":%u,"
+		"\"median_ns\":%.3f,\"min_ns\":%.3f,\"max_ns\":%.3f,\"mad_ns\":%.3f,\"budget_ns\":%.3f,"
+		"\"baseline_ns\":%.3f,\"items_per_second\":%.3f,\"unit\":\"%s\"}\n",
+		bench.name, report.status, report.iterations, samples, report.median,
+		report.min, report.max, report.mad, bench.budget, report.baseline,
+		report.items_per_sec, report.unit);
+}
+
+static void print_context(FILE *out)
+{
+	fprintf(out, "{\"context\":{\"compiler\":\"%s\",\"build\":\"%s\",\"sample_ns\":%d}}\n",
+		__VERSION__, BENCH_BUILD, BENCH_SAMPLE_NANOS);
+}
+
+static void print_text(const BenchCase& bench, const BenchReport& report)
+{
+	if (!report.reason.empty())
+	{
+		printf("%-32s skipped: %s\n", bench.name, report.reason.c_str());
+		return;
+	}
+
+	printf("%-32s %12.1f ns/op  (min %.1f, max %.1f)  %.4g %s/s", bench.name,
+		report.median, report.min, report.max, report.items_per_sec, report.unit);
+
+	if (report.baseline > 0.0)
+	{
+		printf("  %+.1f%% vs baseline", (report.median / report.baseline - 1.0) * 100.0);
+	}
+
+	if (!strcmp(report.status, "over_budget")) printf("  OVER BUDGET");
+	else if (!strcmp(report.status, "regressed")) printf("  REGRESSED");
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	bool json = false;
+	const char *filter = nullptr;
+	const char *baseline_path = nullptr;
+	const char *record_path = nullptr;
+	double tolerance = BENCH_TOLERANCE;
+	unsigned samples = BENCH_SAMPLE_COUNT;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--json"))
+		{
+			json = true;
+		}
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+		{
+			samples = std::max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+		{
+			baseline_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)
+		{
+			tolerance = std::max(0.0, atof(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+		{
+			record_path = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--json] [--filter <substring>] [--samples <count>]\n"
+				"\t[--baseline <file> [--tolerance <ratio>]] [--record <file>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// regressions can only be told apart from noise against a stored run
+	Baseline baseline;
+	if (baseline_path)
+	{
+		if (!read_baseline(baseline, baseline_path))
+		{
+			printf("no baseline at %s, record one with --record or the perf_baseline target\n",
+				baseline_path);
+			return BENCH_SKIPPED;
+		}
+
+		// timings of another build type say nothing about this one
+		if (baseline.build != BENCH_BUILD)
+		{
+			printf("baseline is of a %s build, record one for this %s build\n",
+				baseline.build.empty() ? "unknown" : baseline.build.c_str(), BENCH_BUILD);
+			return BENCH_SKIPPED;
+		}
+	}
+
+	FILE *record = nullptr;
+	if (record_path)
+	{
+		record = fopen(record_path, "w");
+		if (!record)
+		{
+			fprintf(stderr, "failed to open %s\n", record_path);
+			return 1;
+		}
+		print_context(record);
+	}
+
+	// only errors are logged so they don't mix with the results
+	hirzel::logger::init(true, false, "", 0UL);
+
+	// ctest starts it by absolute path, the shell usually by a relative one
+	bench_dir() = std::filesystem::absolute(argv[0]).parent_path().string();
+
+	std::vector<BenchCase> cases = bench_cases();
+	// registration order depends on link order, so the output is sorted
+	std::sort(cases.begin(), cases.end(), [](const BenchCase& a, const BenchCase& b)
+	{
+		return strcmp(a.name, b.name) < 0;
+	});
+
+	if (json) print_context(stdout);
+
+	int status = 0;
+	bool skipped = false;
+	for (const BenchCase& bench : cases)
+	{
+		if (filter && !strstr(bench.name, filter)) continue;
+
+		BenchReport report = run(bench, samples);
+
+		auto base = baseline.reports.find(bench.name);
+		if (base != baseline.reports.end() && report.reason.empty())
+		{
+			// a slow run is measured again before it counts, as load on the
+			// machine is the most common cause
+			if (report.median > regression_limit(base->second, report, tolerance))
+			{
+				BenchReport retry = run(bench, samples);
+				if (retry.median < report.median) report = retry;
+			}
+
+			report.baseline = base->second.median;
+			if (report.median > regression_limit(base->second, report, tolerance))
+			{
+				report.status = "regressed";
+			}
+		}
+
+		if (record) print_json(record, bench, samples, report);
+
+		if (json)
+		{
+			print_json(stdout, bench, samples, report);
+		}
+		else
+		{
+			print_text(bench, report);
+		}
+
+		if (!strcmp(report.status, "over_budget") || !strcmp(report.status, "regressed")) status = 1;
+		if (!strcmp(report.status, "skipped")) skipped = true;
+	}
+
+	if (record) fclose(record);
+
+	// a gate that couldn't run every workload didn't pass either
+	if (status == 0 && skipped && baseline_path) return BENCH_SKIPPED;
+
+	return status;
+}
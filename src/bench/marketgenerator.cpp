@@ -0,0 +1,49 @@
+// local includes
+#include <data/marketgenerator.h>
+#include <util/benchmark.h>
+
+// standard library
+#include <vector>
+
+#define GENERATE_SIZE 4096
+#define BASKET_ASSETS 16
+
+using namespace daytrender;
+
+BENCHMARK(market_generate)
+{
+	MarketGenerator gen;
+	std::vector<Candle> candles(GENERATE_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		gen.generate(candles.data(), GENERATE_SIZE);
+		bench_keep(candles);
+	}
+	state.set_items(GENERATE_SIZE, "candles");
+}
+
+// every feature of the model on a correlated basket
+BENCHMARK(market_generate_basket)
+{
+	MarketModel model;
+	model.garch_alpha = 0.05;
+	model.garch_beta = 0.9;
+	model.regimes = { { 0.1, 0.15 }, { -0.3, 0.6 } };
+	model.regime_switch = 0.001;
+	model.gap_chance = 0.002;
+	model.gap_size = 0.02;
+
+	MarketGenerator gen(model, BASKET_ASSETS);
+	gen.set_correlation(0.5);
+
+	std::vector<std::vector<Candle>> candles(BASKET_ASSETS, std::vector<Candle>(GENERATE_SIZE));
+	std::vector<Candle*> out;
+	for (std::vector<Candle>& asset : candles) out.push_back(asset.data());
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		gen.generate(out.data(), GENERATE_SIZE);
+		bench_keep(candles);
+	}
+	state.set_items(GENERATE_SIZE * BASKET_ASSETS, "candles");
+}
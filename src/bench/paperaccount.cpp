@@ -0,0 +1,46 @@
+// local includes
+#include <data/paperaccount.h>
+#include <data/pricehistory.h>
+#include <util/benchmark.h>
+
+#define HISTORY_SIZE 5000
+// candles between each trade
+#define TRADE_SPACING 10
+
+using namespace daytrender;
+
+BENCHMARK(paperaccount_metrics)
+{
+	// a long history of alternating trades so every metric has data
+	PriceHistory hist = bench_candles(HISTORY_SIZE);
+	PaperAccount acc(500.0, 1, 0.0001, 1.0, hist.front().open(), true, 60, { 30, 10 });
+	for (unsigned i = 0; i < HISTORY_SIZE; ++i)
+	{
+		acc.update_price(hist.get(i).close());
+		if (i % TRADE_SPACING != 0) continue;
+
+		switch ((i / TRADE_SPACING) % 4)
+		{
+		case 0: acc.enter_long(); break;
+		case 1: acc.exit_long(); break;
+		case 2: acc.enter_short(); break;
+		case 3: acc.exit_short(); break;
+		}
+	}
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		double metrics[] =
+		{
+			acc.net_return(),
+			acc.pct_return(),
+			acc.pct_per_year(),
+			acc.return_volatility(),
+			acc.sharpe_ratio(),
+			acc.kelly_criterion(),
+			acc.win_rate(),
+			acc.profit_rate()
+		};
+		bench_keep(metrics);
+	}
+}
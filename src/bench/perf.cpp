@@ -0,0 +1,193 @@
+// local includes
+#include <data/asset.h>
+#include <data/paperaccount.h>
+#include <data/portfolio.h>
+#include <data/pricehistory.h>
+#include <interface/backtest.h>
+#include <util/benchmark.h>
+#include <util/oandacandles.h>
+
+// standard library
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// external libraries
+#include <hirzel/data.h>
+
+/*
+	Fixed workloads that the perf test compares against the stored baseline.
+	They only use generated candles and the simulated client, so they run
+	offline.
+*/
+
+#define PERF_BACKTEST_SIZE 1000000
+#define PERF_PERMUTATIONS 10000
+#define PERF_PERMUTATION_SIZE 100
+#define PERF_ASSETS 100
+#define PERF_RESPONSE_SIZE 5000
+
+using namespace daytrender;
+
+BENCHMARK(perf_backtest)
+{
+	const Asset *asset = bench_asset(state);
+	if (!asset) return;
+
+	static PriceHistory candles = bench_candles(PERF_BACKTEST_SIZE + asset->candle_count());
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		PaperAccount acc(500.0, 1, 0.0001, 1.0, candles.front().open(), false,
+			asset->interval(), asset->ranges());
+		backtest_permutation(acc, *asset, candles, &asset->strategy(), {});
+		bench_keep(acc);
+	}
+	state.set_items(PERF_BACKTEST_SIZE, "candles");
+}
+
+BENCHMARK(perf_permutation_sweep)
+{
+	const Asset *asset = bench_asset(state);
+	if (!asset) return;
+
+	static PriceHistory candles = bench_candles(PERF_PERMUTATION_SIZE + asset->candle_count());
+	const std::vector<int>& limits = asset->ranges();
+	std::vector<int> ranges(limits.size());
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		for (unsigned p = 0; p < PERF_PERMUTATIONS; ++p)
+		{
+			// counting through every combination of ranges up to the asset's own
+			unsigned rest = p;
+			for (size_t r = 0; r < ranges.size(); ++r)
+			{
+				ranges[r] = 1 + rest % limits[r];
+				rest /= limits[r];
+			}
+
+			PaperAccount acc(500.0, 1, 0.0001, 1.0, candles.front().open(), false,
+				asset->interval(), ranges);
+			backtest_permutation(acc, *asset, candles, &asset->strategy(), ranges);
+			bench_keep(acc);
+		}
+	}
+	state.set_items(PERF_PERMUTATIONS, "permutations");
+}
+
+/**
+ * @return	portfolio of PERF_ASSETS assets on the simulated client or nullptr
+ *			if it couldn't be created
+ */
+static Portfolio *perf_portfolio(BenchState& state)
+{
+	static std::unique_ptr<Portfolio> portfolio;
+	static std::string error;
+
+	if (!portfolio && error.empty())
+	{
+		std::string config = "{\"max_loss\":0.5,\"risk\":0.5,"
+			"\"client\":{\"filename\":\"simulated.so\",\"keys\":[\"\"]},\"assets\":[";
+
+		char asset[128];
+		for (unsigned i = 0; i < PERF_ASSETS; ++i)
+		{
+			snprintf(asset, sizeof(asset), "%s{\"ticker\":\"SIM%03u\",\"interval\":60,"
+				"\"strategy\":\"simplema.so\",\"ranges\":[30,10]}", i ? "," : "", i);
+			config += asset;
+		}
+		config += "]}";
+
+		try
+		{
+			portfolio.reset(new Portfolio(hirzel::Data::parse_json(config), "perf", bench_dir()));
+			if (!portfolio->is_ok() || portfolio->assets().size() != PERF_ASSETS)
+			{
+				portfolio.reset();
+				error = "simulated portfolio could not be created";
+			}
+		}
+		catch (const char *err)
+		{
+			error = err;
+		}
+		catch (const std::string& err)
+		{
+			error = err;
+		}
+	}
+
+	if (!portfolio) state.skip(error);
+	return portfolio.get();
+}
+
+// one live tick: fetching, evaluating and trading every asset
+BENCHMARK(perf_live_tick)
+{
+	Portfolio *portfolio = perf_portfolio(state);
+	if (!portfolio) return;
+
+	std::vector<AssetAction> actions;
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		actions.clear();
+		for (unsigned a = 0; a < PERF_ASSETS; ++a)
+		{
+			Result<PriceHistory> res = portfolio->fetch_asset(a);
+			if (!res)
+			{
+				state.skip(res.error());
+				return;
+			}
+
+			PriceHistory hist = res.get();
+			actions.push_back({ a, portfolio->evaluate_asset(a, hist),
+				hist.empty() ? 0.0 : hist.back().close() });
+		}
+
+		portfolio->execute_actions(actions);
+	}
+	state.set_items(PERF_ASSETS, "assets");
+}
+
+/**
+ * @return	candles response in the format the oanda client receives
+ */
+static std::string perf_response(const PriceHistory& candles)
+{
+	std::string out = "{\"instrument\":\"EUR_USD\",\"granularity\":\"M1\",\"candles\":[";
+	char buf[256];
+
+	for (unsigned i = 0; i < candles.size(); ++i)
+	{
+		const Candle& c = candles.get(i);
+		snprintf(buf, sizeof(buf), "%s{\"complete\":true,\"volume\":%.0f,"
+			"\"time\":\"2021-01-01T00:00:00.000000000Z\","
+			"\"mid\":{\"o\":\"%.5f\",\"h\":\"%.5f\",\"l\":\"%.5f\",\"c\":\"%.5f\"}}",
+			i ? "," : "", c.volume(), c.open(), c.high(), c.low(), c.close());
+		out += buf;
+	}
+	out += "]}";
+
+	return out;
+}
+
+BENCHMARK(perf_json_decode)
+{
+	static std::string body = perf_response(bench_candles(PERF_RESPONSE_SIZE));
+	PriceHistory hist(PERF_RESPONSE_SIZE, 60);
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		const char *error = decode_oanda_candles(body, hist);
+		if (error)
+		{
+			state.skip(error);
+			return;
+		}
+		bench_keep(hist);
+	}
+	state.set_items(PERF_RESPONSE_SIZE, "candles");
+}
@@ -0,0 +1,41 @@
+// local includes
+#include <data/pretradecheck.h>
+#include <util/benchmark.h>
+
+#define INSTRUMENTS 256
+// nanoseconds a full set of checks may take
+#define BUDGET 2000.0
+
+using namespace daytrender;
+
+BENCHMARK_BUDGET(pretrade_check, BUDGET)
+{
+	PreTradeLimits limits;
+	limits.max_notional = 1e6;
+	limits.max_position = 1e5;
+	limits.max_deviation = 0.05;
+	limits.max_rate = 1e9;
+	limits.duplicate_window = 1000;
+
+	PreTradeCheck checks(INSTRUMENTS, limits);
+	for (unsigned i = 0; i < INSTRUMENTS; ++i) checks.set_close(i, 100.0 + i);
+
+	unsigned passed = 0;
+	long long now = 1;
+
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		unsigned inst = (i * 7919) % INSTRUMENTS;
+		double shares = (double)(i % 200) - 100.0;
+		now += 1500;
+
+		// every check passes so the whole set is measured
+		if (!checks.check(inst, shares, 100.0 + inst, 0.0, now))
+		{
+			checks.record(inst, shares, now);
+			passed += 1;
+		}
+	}
+
+	bench_keep(passed);
+}
@@ -0,0 +1,48 @@
+// local includes
+#include <data/marketgenerator.h>
+#include <data/pricehistory.h>
+#include <util/benchmark.h>
+
+#define HISTORY_SIZE 500
+#define SLICE_SIZE 100
+
+namespace daytrender
+{
+	PriceHistory bench_candles(unsigned count, unsigned seed)
+	{
+		return MarketGenerator(MarketModel(), 1, seed).history(count);
+	}
+}
+
+using namespace daytrender;
+
+BENCHMARK(pricehistory_construct)
+{
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		PriceHistory hist(HISTORY_SIZE, 60);
+		bench_keep(hist);
+	}
+	state.set_items(HISTORY_SIZE, "candles");
+}
+
+BENCHMARK(pricehistory_copy)
+{
+	PriceHistory source = bench_candles(HISTORY_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		PriceHistory hist(source);
+		bench_keep(hist);
+	}
+	state.set_items(HISTORY_SIZE, "candles");
+}
+
+BENCHMARK(pricehistory_slice)
+{
+	PriceHistory source = bench_candles(HISTORY_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		PriceHistory slice = source.slice(i % (HISTORY_SIZE - SLICE_SIZE), SLICE_SIZE);
+		bench_keep(slice);
+	}
+}
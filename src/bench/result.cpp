@@ -0,0 +1,51 @@
+// local includes
+#include <data/pricehistory.h>
+#include <data/result.h>
+#include <util/benchmark.h>
+
+#define HISTORY_SIZE 500
+
+using namespace daytrender;
+
+static Result<double> make_number(unsigned long long i)
+{
+	if (i == ~0ULL) return "unreachable";
+	return (double)i;
+}
+
+static Result<PriceHistory> make_history(PriceHistory& hist)
+{
+	return std::move(hist);
+}
+
+BENCHMARK(result_double)
+{
+	double sum = 0.0;
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Result<double> res = make_number(i);
+		if (res) sum += res.get();
+	}
+	bench_keep(sum);
+}
+
+BENCHMARK(result_error)
+{
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Result<double> res = make_number(~0ULL);
+		bench_keep(res);
+	}
+}
+
+BENCHMARK(result_pricehistory)
+{
+	PriceHistory hist = bench_candles(HISTORY_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		// moved in and back out the way clients hand over histories
+		Result<PriceHistory> res = make_history(hist);
+		hist = res.get();
+	}
+	bench_keep(hist);
+}
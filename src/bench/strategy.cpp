@@ -0,0 +1,83 @@
+// local includes
+#include <api/strategy.h>
+#include <data/asset.h>
+#include <data/paperaccount.h>
+#include <data/pricehistory.h>
+#include <interface/backtest.h>
+#include <util/benchmark.h>
+
+// standard library
+#include <memory>
+#include <string>
+#include <vector>
+
+// external libraries
+#include <hirzel/data.h>
+
+// plugin in the strategies folder next to daytrender_bench
+#define BENCH_STRATEGY "simplema.so"
+#define BACKTEST_SIZE 2000
+
+using namespace daytrender;
+
+static const char *asset_config = "{\"ticker\":\"BENCH\",\"interval\":60,"
+	"\"strategy\":\"" BENCH_STRATEGY "\",\"ranges\":[30,10]}";
+
+const Asset *daytrender::bench_asset(BenchState& state)
+{
+	static std::unique_ptr<Asset> asset;
+	static std::string error;
+
+	if (!asset && error.empty())
+	{
+		try
+		{
+			asset.reset(new Asset(hirzel::Data::parse_json(asset_config), bench_dir()));
+			if (!asset->is_bound())
+			{
+				asset.reset();
+				error = BENCH_STRATEGY " did not bind";
+			}
+		}
+		catch (const char *err)
+		{
+			error = err;
+		}
+		catch (const std::string& err)
+		{
+			error = err;
+		}
+	}
+
+	if (!asset) state.skip(error);
+	return asset.get();
+}
+
+BENCHMARK(strategy_execute)
+{
+	const Asset *asset = bench_asset(state);
+	if (!asset) return;
+
+	PriceHistory hist = bench_candles(asset->candle_count());
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		Chart chart = asset->strategy().execute(hist, asset->ranges());
+		bench_keep(chart);
+	}
+}
+
+BENCHMARK(backtest_permutation)
+{
+	const Asset *asset = bench_asset(state);
+	if (!asset) return;
+
+	PriceHistory candles = bench_candles(BACKTEST_SIZE);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		PaperAccount acc(500.0, 1, 0.0001, 1.0, candles.front().open(), false,
+			asset->interval(), asset->ranges());
+		backtest_permutation(acc, *asset, candles, &asset->strategy(), {});
+		bench_keep(acc);
+	}
+	state.set_items(BACKTEST_SIZE - asset->candle_count(), "candles");
+}
@@ -0,0 +1,27 @@
+// local includes
+#include <util/benchmark.h>
+#include <util/trace.h>
+
+using namespace daytrender;
+
+// a disabled span is only a flag check, so it can go in any hot path
+BENCHMARK_BUDGET(trace_span_disabled, 5.0)
+{
+	set_tracing(false);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		TRACE_SPAN("disabled");
+		bench_keep(i);
+	}
+}
+
+BENCHMARK(trace_span_enabled)
+{
+	set_tracing(true);
+	for (unsigned long long i = 0; i < state.iterations(); ++i)
+	{
+		TRACE_SPAN("enabled");
+		bench_keep(i);
+	}
+	set_tracing(false);
+}
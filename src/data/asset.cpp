@@ -4,6 +4,7 @@
 #include <data/paperaccount.h>
 #include <data/mathutil.h>
 #include <interface/backtest.h>
+#include <util/asynclog.h>
 
 // external libararies
 #include <hirzel/logger.h>
@@ -54,7 +55,7 @@ namespace daytrender
 	
 	unsigned Asset::update(const PriceHistory& hist)
 	{
-		DEBUG("updating $%s", _ticker);
+		ASYNC_DEBUG("updating $%s", _ticker);
 		// processing the candlestick data gotten from client
 		try
 		{
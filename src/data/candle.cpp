@@ -3,15 +3,6 @@
 
 namespace daytrender
 {
-	Candle::Candle(double open, double high, double low, double close, double volume)
-	{
-		_open = open;
-		_high = high;
-		_low = low;
-		_close = close;
-		_volume = volume;
-	}
-
 	std::string Candle::to_string() const
 	{
 		std::string out;
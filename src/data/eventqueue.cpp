@@ -0,0 +1,87 @@
+#include <data/eventqueue.h>
+
+// standard library
+#include <chrono>
+#include <thread>
+
+namespace daytrender
+{
+	long long EventQueue::epoch_millis()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	long long EventQueue::epoch_micros()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	void EventQueue::set_spin(long long micros)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		_spin = micros;
+	}
+
+	void EventQueue::push(const Event& event)
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		bool earliest = _events.empty() || event.time < _events.top().time;
+		_events.push(event);
+		lock.unlock();
+
+		// the waiting thread only needs to recalculate its timeout if this comes first
+		if (earliest) _cv.notify_one();
+	}
+
+	bool EventQueue::wait(Event& out)
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+
+		while (!_stopped)
+		{
+			if (_events.empty())
+			{
+				_cv.wait(lock);
+				continue;
+			}
+
+			long long delay = _events.top().time * 1000 - epoch_micros();
+			if (delay <= 0)
+			{
+				out = _events.top();
+				_events.pop();
+				return true;
+			}
+
+			if (delay > _spin)
+			{
+				_cv.wait_for(lock, std::chrono::microseconds(delay - _spin));
+				continue;
+			}
+
+			// close enough to the deadline to poll instead of sleeping
+			lock.unlock();
+			std::this_thread::yield();
+			lock.lock();
+		}
+
+		return false;
+	}
+
+	void EventQueue::stop()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		_stopped = true;
+		lock.unlock();
+		_cv.notify_all();
+	}
+
+	void EventQueue::clear()
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		_events = {};
+		_stopped = false;
+	}
+}
@@ -0,0 +1,9 @@
+#include <data/fill.h>
+
+namespace daytrender
+{
+	Fill::Fill(double shares, double price, double fee) :
+		_shares(shares),
+		_price(price),
+		_fee(fee) {}
+}
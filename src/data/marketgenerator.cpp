@@ -0,0 +1,439 @@
+#include <data/marketgenerator.h>
+
+// standard library
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// seconds in the year that drift and volatility are annualized over
+#define YEAR_SECONDS (365.0 * 24.0 * 3600.0)
+// below this probability, and above one minus it, the quantile uses the tail formula
+#define NORMAL_TAIL 0.02425
+
+namespace daytrender
+{
+	namespace
+	{
+		inline uint64_t rotl(uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+		inline uint64_t splitmix64(uint64_t& state)
+		{
+			uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+
+		// coefficients of Acklam's rational approximation of the normal quantile
+		const double quantile_a[] = { -3.969683028665376e+01, 2.209460984245205e+02,
+			-2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01,
+			2.506628277459239e+00 };
+		const double quantile_b[] = { -5.447609879822406e+01, 1.615858368580409e+02,
+			-1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01 };
+		const double quantile_c[] = { -7.784894002430293e-03, -3.223964580411365e-01,
+			-2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00,
+			2.938163982698783e+00 };
+		const double quantile_d[] = { 7.784695709041462e-03, 3.224671290700398e-01,
+			2.445134137142996e+00, 3.754408661907416e+00 };
+
+		// only valid away from the tails, but has no branches or calls so loops of it vectorize
+		inline double central_quantile(double p)
+		{
+			const double *a = quantile_a;
+			const double *b = quantile_b;
+			double q = p - 0.5;
+			double r = q * q;
+
+			return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+				/ (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+		}
+
+		inline double tail_quantile(double p)
+		{
+			const double *c = quantile_c;
+			const double *d = quantile_d;
+			double q = std::sqrt(-2.0 * std::log(p));
+
+			return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+				/ ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+		}
+
+		/**
+		 * exp() without calls or branches so loops of it vectorize, accurate
+		 * to about 1e-15 relative
+		 */
+		inline double fast_exp(double x)
+		{
+			// adding this rounds to an integer that ends up in the low mantissa bits
+			const double round = 6755399441055744.0;
+
+			x = std::min(std::max(x, -700.0), 700.0);
+			double shifted = x * 1.4426950408889634 + round;
+			uint64_t bits;
+			std::memcpy(&bits, &shifted, sizeof(bits));
+			double n = shifted - round;
+
+			// x = n * ln(2) + r, with ln(2) split in two so r stays exact
+			double r = x - n * 6.93147180369123816490e-01 - n * 1.90821492927058770002e-10;
+			double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120
+				+ r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880
+				+ r * (1.0 / 3628800 + r * (1.0 / 39916800 + r * (1.0 / 479001600))))))))))));
+
+			uint64_t scale_bits = (bits + 1023) << 52;
+			double scale;
+			std::memcpy(&scale, &scale_bits, sizeof(scale));
+
+			return p * scale;
+		}
+
+		struct RegimeParams
+		{
+			// per candle
+			double drift;
+			double sigma;
+		};
+	}
+
+	double normal_quantile(double p)
+	{
+		if (p < NORMAL_TAIL) return tail_quantile(p);
+		if (p > 1.0 - NORMAL_TAIL) return -tail_quantile(1.0 - p);
+		return central_quantile(p);
+	}
+
+	RandomStream::RandomStream(uint64_t seed)
+	{
+		uint64_t state = seed;
+		for (unsigned lane = 0; lane < RANDOM_LANES; ++lane)
+		{
+			for (unsigned i = 0; i < 4; ++i)
+			{
+				_state[i][lane] = splitmix64(state);
+			}
+		}
+	}
+
+	void RandomStream::fill_uniform(double *out, size_t count)
+	{
+		uint64_t (&s)[4][RANDOM_LANES] = _state;
+		double block[RANDOM_LANES];
+
+		for (size_t i = 0; i < count; i += RANDOM_LANES)
+		{
+			for (unsigned lane = 0; lane < RANDOM_LANES; ++lane)
+			{
+				uint64_t result = rotl(s[1][lane] * 5, 7) * 9;
+				uint64_t t = s[1][lane] << 17;
+
+				s[2][lane] ^= s[0][lane];
+				s[3][lane] ^= s[1][lane];
+				s[1][lane] ^= s[2][lane];
+				s[0][lane] ^= s[3][lane];
+				s[2][lane] ^= t;
+				s[3][lane] = rotl(s[3][lane], 45);
+
+				// the top 52 bits become the mantissa of a double in [1, 2),
+				// and half a step is added so neither 0 nor 1 come out
+				uint64_t bits = (result >> 12) | 0x3ff0000000000000ULL;
+				double value;
+				std::memcpy(&value, &bits, sizeof(value));
+				block[lane] = value - (1.0 - 0x1.0p-53);
+			}
+
+			size_t left = count - i;
+			std::memcpy(out + i, block, sizeof(double) * (left < RANDOM_LANES ? left : RANDOM_LANES));
+		}
+	}
+
+	void RandomStream::fill_normal(double *out, double *scratch, size_t count)
+	{
+		fill_uniform(scratch, count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			out[i] = central_quantile(scratch[i]);
+		}
+
+		// about one in twenty draws lands in a tail
+		for (size_t i = 0; i < count; ++i)
+		{
+			double p = scratch[i];
+			if (p < NORMAL_TAIL)
+			{
+				out[i] = tail_quantile(p);
+			}
+			else if (p > 1.0 - NORMAL_TAIL)
+			{
+				out[i] = -tail_quantile(1.0 - p);
+			}
+		}
+	}
+
+	const char *check_market_model(const MarketModel& model)
+	{
+		if (model.interval == 0) return "interval must be greater than zero";
+		if (!(model.price > 0.0)) return "price must be greater than zero";
+		if (!(model.volatility >= 0.0)) return "volatility must not be negative";
+		if (!(model.garch_alpha >= 0.0) || !(model.garch_beta >= 0.0))
+		{
+			return "garch weights must not be negative";
+		}
+		if (model.garch_alpha + model.garch_beta >= 1.0)
+		{
+			return "garch weights must sum to less than one";
+		}
+		if (!(model.regime_switch >= 0.0 && model.regime_switch <= 1.0))
+		{
+			return "regime switch chance must be a ratio";
+		}
+		for (const MarketRegime& regime : model.regimes)
+		{
+			if (!(regime.volatility >= 0.0)) return "regime volatility must not be negative";
+		}
+		if (!(model.gap_chance >= 0.0 && model.gap_chance <= 1.0))
+		{
+			return "gap chance must be a ratio";
+		}
+		if (!(model.gap_size >= 0.0)) return "gap size must not be negative";
+		if (!(model.volume >= 0.0)) return "volume must not be negative";
+
+		return nullptr;
+	}
+
+	MarketGenerator::MarketGenerator(const MarketModel& model, unsigned assets, uint64_t seed) :
+	_model(model),
+	_assets(assets > 0 ? assets : 1),
+	_rng(seed),
+	_close(_assets, model.price),
+	_variance(_assets, 1.0),
+	_shocks((size_t)_assets * MARKET_BLOCK_SIZE),
+	_uniform(((size_t)_assets * 4 + 1) * MARKET_BLOCK_SIZE),
+	_scratch((size_t)std::max(_assets, 3u) * MARKET_BLOCK_SIZE),
+	_regimes(MARKET_BLOCK_SIZE)
+	{}
+
+	const char *MarketGenerator::set_correlation(double correlation)
+	{
+		std::vector<double> matrix((size_t)_assets * _assets, correlation);
+		for (unsigned i = 0; i < _assets; ++i) matrix[i * _assets + i] = 1.0;
+
+		return set_correlation(matrix);
+	}
+
+	const char *MarketGenerator::set_correlation(const std::vector<double>& matrix)
+	{
+		unsigned n = _assets;
+		if (matrix.size() != (size_t)n * n) return "correlation matrix does not match the asset count";
+
+		for (unsigned i = 0; i < n; ++i)
+		{
+			if (matrix[i * n + i] != 1.0) return "correlation matrix must have ones on its diagonal";
+			for (unsigned j = 0; j < i; ++j)
+			{
+				if (matrix[i * n + j] != matrix[j * n + i]) return "correlation matrix must be symmetric";
+			}
+		}
+
+		// cholesky decomposition, allowing perfectly correlated assets
+		std::vector<double> lower((size_t)n * n, 0.0);
+		for (unsigned j = 0; j < n; ++j)
+		{
+			double pivot = matrix[j * n + j];
+			for (unsigned k = 0; k < j; ++k) pivot -= lower[j * n + k] * lower[j * n + k];
+			if (pivot < -1e-9) return "correlation matrix is not positive semidefinite";
+
+			double diag = pivot > 1e-12 ? std::sqrt(pivot) : 0.0;
+			lower[j * n + j] = diag;
+
+			for (unsigned i = j + 1; i < n; ++i)
+			{
+				double sum = matrix[i * n + j];
+				for (unsigned k = 0; k < j; ++k) sum -= lower[i * n + k] * lower[j * n + k];
+				lower[i * n + j] = diag > 0.0 ? sum / diag : 0.0;
+			}
+		}
+
+		_cholesky = std::move(lower);
+
+		return nullptr;
+	}
+
+	void MarketGenerator::generate_block(Candle *const *out, size_t offset, unsigned count)
+	{
+		const MarketModel& m = _model;
+		size_t n = (size_t)_assets * count;
+		bool gaps = m.gap_chance > 0.0;
+		bool switching = m.regimes.size() > 1 && m.regime_switch > 0.0;
+		bool garch = m.garch_alpha > 0.0 || m.garch_beta > 0.0;
+
+		// uniform draws are volumes, upper wicks, lower wicks, gaps, then regime switches
+		_rng.fill_normal(_shocks.data(), _scratch.data(), n);
+		_rng.fill_uniform(_uniform.data(), n * (gaps ? 4 : 3) + (switching ? count : 0));
+
+		// mixing the shocks of every step so the assets move together
+		if (!_cholesky.empty())
+		{
+			// going from the last asset down leaves the rows still needed untouched
+			double *mixed = _scratch.data();
+			for (unsigned i = _assets; i-- > 0;)
+			{
+				double *row = _shocks.data() + (size_t)i * count;
+				double weight = _cholesky[i * _assets + i];
+				for (unsigned k = 0; k < count; ++k) mixed[k] = weight * row[k];
+
+				for (unsigned j = 0; j < i; ++j)
+				{
+					const double *other = _shocks.data() + (size_t)j * count;
+					weight = _cholesky[i * _assets + j];
+					for (unsigned k = 0; k < count; ++k) mixed[k] += weight * other[k];
+				}
+
+				std::copy(mixed, mixed + count, row);
+			}
+		}
+
+		// the regime is shared by the whole market
+		const double *regime_draws = _uniform.data() + n * (gaps ? 4 : 3);
+		unsigned regime_count = m.regimes.empty() ? 1 : m.regimes.size();
+		for (unsigned k = 0; k < count; ++k)
+		{
+			_regimes[k] = _regime;
+			if (!switching || regime_draws[k] >= m.regime_switch) continue;
+
+			// the draw below the chance is itself uniform, so it picks the next regime
+			unsigned pick = (unsigned)(regime_draws[k] / m.regime_switch * (regime_count - 1));
+			if (pick >= regime_count - 1) pick = regime_count - 2;
+			_regime = pick >= _regime ? pick + 1 : pick;
+		}
+
+		double dt = m.interval / YEAR_SECONDS;
+		std::vector<RegimeParams> regimes(regime_count);
+		for (unsigned r = 0; r < regime_count; ++r)
+		{
+			double drift = m.regimes.empty() ? m.drift : m.regimes[r].drift;
+			double volatility = m.regimes.empty() ? m.volatility : m.regimes[r].volatility;
+
+			regimes[r].drift = drift * dt;
+			regimes[r].sigma = volatility * std::sqrt(dt);
+		}
+
+		// the shocks are used up, so the scratch space holds per candle factors
+		double *growth = _scratch.data();
+		double *highs = growth + count;
+		double *lows = highs + count;
+		double omega = 1.0 - m.garch_alpha - m.garch_beta;
+
+		for (unsigned a = 0; a < _assets; ++a)
+		{
+			const double *shocks = _shocks.data() + (size_t)a * count;
+			const double *volumes = _uniform.data() + (size_t)a * count;
+			const double *high_draws = volumes + n;
+			const double *low_draws = high_draws + n;
+			const double *gap_draws = low_draws + n;
+			double variance = _variance[a];
+
+			// the variance only depends on the last one, so the square roots
+			// below stay off the chain
+			if (garch)
+			{
+				for (unsigned k = 0; k < count; ++k)
+				{
+					highs[k] = variance;
+					variance = omega + (m.garch_alpha * shocks[k] * shocks[k] + m.garch_beta) * variance;
+				}
+			}
+			else
+			{
+				std::fill(highs, highs + count, 1.0);
+			}
+
+			// log returns and the standard deviation each candle's wicks scale with
+			if (regime_count == 1)
+			{
+				const RegimeParams regime = regimes[0];
+				for (unsigned k = 0; k < count; ++k)
+				{
+					double sigma = regime.sigma * std::sqrt(highs[k]);
+					growth[k] = regime.drift - 0.5 * sigma * sigma + sigma * shocks[k];
+					highs[k] = sigma;
+				}
+			}
+			else
+			{
+				for (unsigned k = 0; k < count; ++k)
+				{
+					const RegimeParams& regime = regimes[_regimes[k]];
+					double sigma = regime.sigma * std::sqrt(highs[k]);
+					growth[k] = regime.drift - 0.5 * sigma * sigma + sigma * shocks[k];
+					highs[k] = sigma;
+				}
+			}
+
+			// wicks reach up to one standard deviation of the return past the body
+			for (unsigned k = 0; k < count; ++k)
+			{
+				double sigma = highs[k];
+				growth[k] = fast_exp(growth[k]);
+				highs[k] = 1.0 + sigma * high_draws[k];
+				lows[k] = 1.0 / (1.0 + sigma * low_draws[k]);
+			}
+
+			Candle *dst = out[a] + offset;
+			double close = _close[a];
+			for (unsigned k = 0; k < count; ++k)
+			{
+				double open = close;
+				if (gaps && gap_draws[k] < m.gap_chance)
+				{
+					open *= std::exp(m.gap_size * normal_quantile(gap_draws[k] / m.gap_chance));
+				}
+
+				close = open * growth[k];
+				dst[k] = Candle(open, std::max(open, close) * highs[k], std::min(open, close) * lows[k],
+					close, m.volume * (0.5 + volumes[k]));
+			}
+
+			_close[a] = close;
+			_variance[a] = variance;
+		}
+	}
+
+	void MarketGenerator::generate(Candle *const *out, unsigned count)
+	{
+		for (unsigned offset = 0; offset < count; offset += MARKET_BLOCK_SIZE)
+		{
+			unsigned left = count - offset;
+			generate_block(out, offset, left < MARKET_BLOCK_SIZE ? left : MARKET_BLOCK_SIZE);
+		}
+	}
+
+	PriceHistory MarketGenerator::history(unsigned count)
+	{
+		if (_assets != 1) return basket(count).front();
+
+		PriceHistory hist(count, _model.interval);
+		if (count > 0) generate(&hist.get(0), count);
+
+		return hist;
+	}
+
+	std::vector<PriceHistory> MarketGenerator::basket(unsigned count)
+	{
+		std::vector<PriceHistory> out;
+		std::vector<Candle*> candles;
+		out.reserve(_assets);
+
+		for (unsigned a = 0; a < _assets; ++a)
+		{
+			out.emplace_back(count, _model.interval);
+			candles.push_back(count > 0 ? &out.back().get(0) : nullptr);
+		}
+
+		if (count > 0) generate(candles.data(), count);
+
+		return out;
+	}
+}
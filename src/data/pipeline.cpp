@@ -0,0 +1,216 @@
+#include <data/pipeline.h>
+
+// local includes
+#include <util/allocations.h>
+#include <util/asynclog.h>
+#include <util/trace.h>
+
+// standard library
+#include <algorithm>
+#include <vector>
+
+// external libraries
+#include <hirzel/logger.h>
+
+namespace daytrender
+{
+	Pipeline::Pipeline(Portfolio& portfolio, ThreadPool& pool, unsigned spin) :
+	_portfolio(portfolio),
+	_pool(pool),
+	_candles(PIPELINE_CANDLE_CAPACITY),
+	_signals(PIPELINE_SIGNAL_CAPACITY),
+	_running(true),
+	_evaluate_since(0),
+	_execute_since(0),
+	_ingest([this](const std::vector<Event>& events) { ingest(events); })
+	{
+		_evaluate_parker.set_spin(spin);
+		_execute_parker.set_spin(spin);
+		_evaluate_thread = std::thread(&Pipeline::evaluate, this);
+		_execute_thread = std::thread(&Pipeline::execute, this);
+	}
+
+	Pipeline::~Pipeline()
+	{
+		stop();
+	}
+
+	void Pipeline::ingest(const std::vector<Event>& events)
+	{
+		TRACE_SPAN("Pipeline::ingest");
+		TICK_ALLOCATION_SCOPE(ALLOC_PIPELINE);
+		// do nothing if portfolio is not live
+		if (!_portfolio.is_live())
+		{
+			ASYNC_DEBUG("%s portfolio is not live and cannot be updated",
+				_portfolio.label());
+			return;
+		}
+
+		// every due asset is requested at once
+		_fetches.clear();
+		for (const Event& event : events)
+		{
+			// account updates go straight to execution so they never race orders
+			if (event.asset == Event::PORTFOLIO)
+			{
+				publish({ Event::PORTFOLIO, NOTHING, 0.0 });
+				continue;
+			}
+
+			// events are due a fixed offset after the candle closes
+			long long tick = (event.time - _portfolio.update_offset()) * 1000;
+			_fetches.push_back({ event.asset, tick, _portfolio.fetch_asset_async(event.asset) });
+		}
+
+		for (Fetch& fetch : _fetches)
+		{
+			Result<PriceHistory> res = fetch.hist.get();
+			if (!res)
+			{
+				ASYNC_ERROR("(%s) $%s: %s", _portfolio.label(),
+					_portfolio.assets()[fetch.asset].ticker(), res.error());
+				continue;
+			}
+
+			Candles candles;
+			candles.asset = fetch.asset;
+			candles.hist = res.get();
+			candles.tick = fetch.tick;
+
+			// backpressure: waiting for the evaluator to make room
+			while (!_candles.push(std::move(candles)))
+			{
+				if (!_running.load(std::memory_order_relaxed)) return;
+				std::this_thread::yield();
+			}
+			_evaluate_parker.wake();
+		}
+	}
+
+	void Pipeline::evaluate()
+	{
+		std::vector<Candles> batch(_candles.capacity());
+		std::vector<Signal> signals(_candles.capacity());
+		std::function<void(unsigned)> task = [&](unsigned i)
+		{
+			// runs on the pool's threads, which aren't inside the tick otherwise
+			TICK_ALLOCATION_SCOPE(ALLOC_PIPELINE);
+			signals[i].asset = batch[i].asset;
+			signals[i].action = _portfolio.evaluate_asset(batch[i].asset, batch[i].hist);
+			signals[i].price = batch[i].hist.empty() ? 0.0 : batch[i].hist.back().close();
+			signals[i].tick = batch[i].tick;
+		};
+
+		while (true)
+		{
+			_evaluate_parker.wait([&]()
+			{
+				return !_running.load(std::memory_order_relaxed) || !_candles.empty();
+			});
+			if (!_running.load(std::memory_order_relaxed)) break;
+
+			TRACE_SPAN("Pipeline::evaluate");
+			TICK_ALLOCATION_SCOPE(ALLOC_PIPELINE);
+			// everything fetched so far is evaluated together
+			unsigned count = 0;
+			while (count < batch.size() && _candles.pop(batch[count])) count += 1;
+
+			_evaluate_since.store(EventQueue::epoch_millis(), std::memory_order_relaxed);
+			_pool.run(count, task);
+			_evaluate_since.store(0, std::memory_order_relaxed);
+
+			// actions are executed in asset order no matter which finished first
+			std::stable_sort(signals.begin(), signals.begin() + count,
+				[](const Signal& a, const Signal& b) { return a.asset < b.asset; });
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				publish(std::move(signals[i]));
+			}
+		}
+	}
+
+	void Pipeline::execute()
+	{
+		Signal signal;
+		std::vector<AssetAction> actions;
+		actions.reserve(_signals.capacity());
+
+		while (true)
+		{
+			_execute_parker.wait([&]()
+			{
+				return !_running.load(std::memory_order_relaxed) || !_signals.empty();
+			});
+			if (!_running.load(std::memory_order_relaxed)) break;
+
+			TRACE_SPAN("Pipeline::execute");
+			TICK_ALLOCATION_SCOPE(ALLOC_PIPELINE);
+			// everything queued so far is executed as one tick so a
+			// rebalancing portfolio can net its orders
+			_execute_since.store(EventQueue::epoch_millis(), std::memory_order_relaxed);
+			while (_signals.pop(signal))
+			{
+				if (signal.asset != Event::PORTFOLIO)
+				{
+					actions.push_back({ (unsigned)signal.asset, signal.action, signal.price,
+						signal.tick });
+					continue;
+				}
+
+				// actions from before an account update go first
+				_portfolio.execute_actions(actions);
+				actions.clear();
+
+				// update account/ pl info
+				_portfolio.update();
+			}
+
+			_portfolio.execute_actions(actions);
+			actions.clear();
+			_execute_since.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void Pipeline::publish(Signal&& signal)
+	{
+		while (!_signals.push(std::move(signal)))
+		{
+			if (!_running.load(std::memory_order_relaxed)) return;
+			std::this_thread::yield();
+		}
+		_execute_parker.wake();
+	}
+
+	void Pipeline::stop()
+	{
+		// ingest is stopped first so nothing is blocked on a full queue
+		_running.store(false);
+		_ingest.stop();
+		_evaluate_parker.wake();
+		_execute_parker.wake();
+
+		if (_evaluate_thread.joinable()) _evaluate_thread.join();
+		if (_execute_thread.joinable()) _execute_thread.join();
+	}
+
+	void Pipeline::report() const
+	{
+		INFO("%s pipeline: candles %llu pushed, %llu blocked, %llu max depth; "
+			"signals %llu pushed, %llu blocked, %llu max depth",
+			_portfolio.label(),
+			(unsigned long long)_candles.pushed(),
+			(unsigned long long)_candles.rejected(),
+			(unsigned long long)_candles.high_water(),
+			(unsigned long long)_signals.pushed(),
+			(unsigned long long)_signals.rejected(),
+			(unsigned long long)_signals.high_water());
+	}
+
+	long long Pipeline::busy_for(long long now) const
+	{
+		return std::max({ _ingest.busy_for(now), elapsed(_evaluate_since, now),
+			elapsed(_execute_since, now) });
+	}
+}
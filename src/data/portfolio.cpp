@@ -1,5 +1,12 @@
 #include <data/portfolio.h>
 
+// local includes
+#include <data/eventqueue.h>
+#include <data/rebalance.h>
+#include <util/allocations.h>
+#include <util/asynclog.h>
+#include <util/trace.h>
+
 // standard library
 #include <cmath>
 
@@ -14,6 +21,22 @@ using logger::print;
 
 namespace daytrender
 {
+	// fills in the limits given in json, leaving the others as they are
+	static PreTradeLimits read_pretrade_limits(const Data& json, PreTradeLimits limits)
+	{
+		if (json.contains("max_notional")) limits.max_notional = json["max_notional"].to_double();
+		if (json.contains("max_position")) limits.max_position = json["max_position"].to_double();
+		if (json.contains("max_deviation")) limits.max_deviation = json["max_deviation"].to_double();
+		if (json.contains("max_rate")) limits.max_rate = json["max_rate"].to_double();
+		// milliseconds in the config
+		if (json.contains("duplicate_window"))
+		{
+			limits.duplicate_window = (long long)json["duplicate_window"].to_uint() * 1000;
+		}
+
+		return limits;
+	}
+
 	Portfolio::Portfolio(const Data& config, const std::string& label,
 		const std::string& dir) :
 	_label(label)
@@ -32,6 +55,25 @@ namespace daytrender
 			return;
 		}
 
+		long long window = (long long)(_history_length * 3600);
+		_equity_history = EquityHistory(window / PORTFOLIO_UPDATE_INTERVAL
+			* EQUITY_HISTORY_HEADROOM + 1, window);
+
+		if (config.contains("update_offset"))
+		{
+			_update_offset = config["update_offset"].to_uint();
+		}
+
+		if (config.contains("timeout"))
+		{
+			_timeout = config["timeout"].to_uint();
+		}
+
+		if (config.contains("rebalance"))
+		{
+			_rebalance = config["rebalance"].to_uint() != 0;
+		}
+
 		// CLIENT	============================================================
 
 		const Data& client_json = config["client"];
@@ -134,18 +176,62 @@ namespace daytrender
 			i += 1;
 		}
 
+		// quoting starts now, so that the first entries have a fee and a price
+		for (const Asset& asset : _assets) _client.track_spread(asset.ticker());
+
+		// RISK	================================================================
+
+		RiskLimits limits;
+		double decay = RISK_DEFAULT_DECAY;
+		if (config.contains("risk_limits"))
+		{
+			const Data& limits_json = config["risk_limits"];
+			if (limits_json.contains("gross")) limits.gross = limits_json["gross"].to_double();
+			if (limits_json.contains("net")) limits.net = limits_json["net"].to_double();
+			if (limits_json.contains("currency")) limits.currency = limits_json["currency"].to_double();
+			if (limits_json.contains("var")) limits.var = limits_json["var"].to_double();
+			if (limits_json.contains("decay")) decay = limits_json["decay"].to_double();
+
+			if (decay <= 0.0 || decay >= 1.0)
+			{
+				ERROR("%s: risk decay must be between 0 and 1", _label);
+				return;
+			}
+		}
+
+		std::vector<std::string> tickers;
+		for (const Asset& asset : _assets) tickers.push_back(asset.ticker());
+		_risk_engine = RiskEngine(tickers, limits, decay);
+
+		// assets can override the portfolio's pre-trade limits
+		PreTradeLimits pretrade_limits;
+		if (config.contains("pretrade"))
+		{
+			pretrade_limits = read_pretrade_limits(config["pretrade"], pretrade_limits);
+		}
+
+		_pretrade = PreTradeCheck(_assets.size(), pretrade_limits);
+		_latency = LatencyTracker(_assets.size());
+		for (unsigned i = 0; i < _assets.size(); ++i)
+		{
+			if (!assets_json[i].contains("pretrade")) continue;
+			_pretrade.set_limits(i, read_pretrade_limits(assets_json[i]["pretrade"], pretrade_limits));
+		}
+
 		_ok = true;
 	}
 
 
 	void Portfolio::update()
 	{
+		TRACE_SPAN("Portfolio::update");
+		ALLOCATION_SCOPE(ALLOC_PORTFOLIO);
 		if (!_ok)
 		{
 			WARNING("%s portfolio is not okay and cannot be updated", _label);
 			return;
 		}
-		DEBUG("Updating %s portfolio information", _label);
+		ASYNC_DEBUG("Updating %s portfolio information", _label);
 
 		long long curr_time = hirzel::sys::epoch_seconds();
 		_last_update = curr_time;
@@ -161,16 +247,17 @@ namespace daytrender
 		}
 
 		Account info = res.get();
+		_risk_engine.set_equity(info.equity());
 
-		_equity_history.push_back({ curr_time, info.equity() });
+		_equity_history.push(curr_time, info.equity());
 
-		while (curr_time - _equity_history[0].first > (long long)(_history_length * 3600))
-		{
-			_equity_history.erase(_equity_history.begin());
-		}
-
-		double prev_equity = _equity_history.front().second;
-		_pl = info.equity() - prev_equity;
+		double prev_equity = _equity_history.front().equity;
+		_pl = _equity_history.pl();
+		_gauges->equity.store(info.equity(), std::memory_order_relaxed);
+		_gauges->pl.store(_pl, std::memory_order_relaxed);
+		_gauges->drawdown.store(_equity_history.drawdown(), std::memory_order_relaxed);
+		ASYNC_DEBUG("%s: $%f p/l and $%f drawdown in the last %f hours", _label, _pl,
+			_equity_history.drawdown(), _history_length);
 
 		// account has lost too much in last interval
 		if (_pl <= prev_equity * -_max_loss)
@@ -185,6 +272,7 @@ namespace daytrender
 				ERROR("%s: %s", _label, error);
 				return;
 			}
+			for (unsigned i = 0; i < _assets.size(); ++i) _risk_engine.set_shares(i, 0.0);
 		}
 		
 		// if within closeout buffer of market is closed and there is a buffer set
@@ -198,54 +286,247 @@ namespace daytrender
 				ERROR("%s: %s", _label, error);
 				return;
 			}
+			for (unsigned i = 0; i < _assets.size(); ++i) _risk_engine.set_shares(i, 0.0);
 		}		
 	}
 
 
-	void Portfolio::update_assets()
+	void Portfolio::update_asset(unsigned index)
 	{
-		DEBUG("Updating %s assets", _label);
-		for (Asset& asset : _assets)
+		Result<PriceHistory> res = fetch_asset(index);
+		if (!res) return;
+
+		PriceHistory hist = res.get();
+		execute_action(index, evaluate_asset(index, hist),
+			hist.empty() ? 0.0 : hist.back().close());
+	}
+
+
+	Result<PriceHistory> Portfolio::fetch_asset(unsigned index)
+	{
+		const Asset& asset = _assets[index];
+
+		Result<PriceHistory> res = _client.get_price_history(asset);
+		if (!res)
 		{
-			// skip if it shouldn't update yet
-			if (!asset.should_update()) continue;
+			ERROR("(%s) $%s: %s", _label, asset.ticker(), res.error());
+		}
 
-			Result<PriceHistory> res = _client.get_price_history(asset);
-			if (!res)
+		return res;
+	}
+
+
+	std::future<Result<PriceHistory>> Portfolio::fetch_asset_async(unsigned index) const
+	{
+		return _client.get_price_history_async(_assets[index],
+			&_latency.histogram(index, STAGE_FETCH));
+	}
+
+
+	unsigned Portfolio::evaluate_asset(unsigned index, const PriceHistory& hist)
+	{
+		TRACE_SPAN("Portfolio::evaluate_asset");
+		ALLOCATION_SCOPE(ALLOC_PORTFOLIO);
+		long long start = monotonic_nanos();
+		unsigned action = _assets[index].update(hist);
+		long long elapsed = monotonic_nanos() - start;
+		_latency.record(index, STAGE_EVALUATE, elapsed);
+		count_metric(METRIC_STRATEGY_EXECUTIONS);
+		count_metric(METRIC_STRATEGY_NANOS, elapsed);
+
+		return action;
+	}
+
+
+	const char *Portfolio::enter_position(unsigned index, bool short_shares, long long tick)
+	{
+		const Asset& asset = _assets[index];
+
+		double price = 0.0;
+		long long start = monotonic_nanos();
+
+		Result<double> res = _client.shares_to_enter(asset, _risk / risk_sum(), short_shares,
+			[&](double shares, double quote)
+		{
+			price = quote;
+			double allowed = _risk_engine.limit_order(index, shares);
+			if (allowed != shares)
 			{
-				// ERROR
-				ERROR("(%s) $%s: %s", _label, asset.ticker(), res.error());
-				continue;
+				WARNING("(%s) $%s: risk limits reduced order from %f to %f shares",
+					_label, asset.ticker(), shares, allowed);
 			}
+			return allowed;
+		});
+		_latency.record(index, STAGE_SIZING, monotonic_nanos() - start);
+		if (!res) return res.error();
+
+		double shares = res.get();
+		if (shares == 0.0) return nullptr;
+
+		long long now = EventQueue::epoch_micros();
+		const char *error = _pretrade.check(index, shares, price, _risk_engine.shares(index), now);
+		if (error)
+		{
+			count_metric(METRIC_ORDERS_BLOCKED);
+			return error;
+		}
+
+		ASYNC_DEBUG("Placing order for %f shares!!!", shares);
+
+		start = monotonic_nanos();
+		Result<Fill> fill = _client.market_order(asset.ticker(), shares);
+		_latency.record(index, STAGE_ORDER, monotonic_nanos() - start);
+		if (tick > 0) _latency.record(index, STAGE_TICK_TO_ORDER, (EventQueue::epoch_micros() - tick) * 1000);
+		if (!fill) return fill.error();
+
+		_pretrade.record(index, shares, now);
+		_risk_engine.add_shares(index, fill.get().shares());
+
+		return nullptr;
+	}
+
+
+	const char *Portfolio::exit_position(unsigned index, bool short_shares, long long tick)
+	{
+		// the client queries the position and orders in one call
+		long long start = monotonic_nanos();
+		const char *error = _client.exit_position(_assets[index], short_shares);
+		_latency.record(index, STAGE_ORDER, monotonic_nanos() - start);
+		if (tick > 0) _latency.record(index, STAGE_TICK_TO_ORDER, (EventQueue::epoch_micros() - tick) * 1000);
+
+		// the client only exits positions on the requested side
+		double shares = _risk_engine.shares(index);
+		if (!error && (short_shares ? shares < 0.0 : shares > 0.0))
+		{
+			_risk_engine.set_shares(index, 0.0);
+		}
+
+		return error;
+	}
+
 
-			unsigned action = asset.update(res.get());
+	void Portfolio::execute_action(unsigned index, unsigned action, double price, long long tick)
+	{
+		Asset& asset = _assets[index];
+		bool update_portfolio = false;
+		const char *error = nullptr;
+
+		_risk_engine.update_price(index, price);
+		_pretrade.set_close(index, price);
+
+		switch (action)
+		{
+		case ENTER_LONG:
+			error = enter_position(index, false, tick);
+			update_portfolio = true;
+			break;
+
+		case EXIT_LONG:
+			error = exit_position(index, false, tick);
+			update_portfolio = true;
+			break;
+
+		case ENTER_SHORT:
+			error = enter_position(index, true, tick);
+			update_portfolio = true;
+			break;
+
+		case EXIT_SHORT:
+			error = exit_position(index, true, tick);
+			update_portfolio = true;
+			break;
+
+		case NOTHING:
+			ASYNC_INFO("(%s) $%s: No action taken", _label, asset.ticker());
+			break;
+
+		case ERROR:
+			ERROR("(%s) $%s: failed to update", _label, asset.ticker());
+			_ok = false;
+			break;
 
-			bool update_portfolio = false;
+		default:
+			ERROR("(%s) $%s: Invalid action received from strategy: %d",
+				_label, asset.ticker(), action);
+			break;
+		}
 
-			switch (action)
+		if (error) ERROR("(%s) $%s: %s", _label, asset.ticker(), error);
+
+		// if an order was placed
+		if (update_portfolio) update();
+	}
+
+
+	void Portfolio::execute_actions(const std::vector<AssetAction>& actions)
+	{
+		TRACE_SPAN("Portfolio::execute_actions");
+		ALLOCATION_SCOPE(ALLOC_PORTFOLIO);
+		if (_rebalance)
+		{
+			rebalance(actions);
+			return;
+		}
+
+		for (const AssetAction& act : actions)
+		{
+			execute_action(act.asset, act.action, act.price, act.tick);
+		}
+	}
+
+
+	void Portfolio::rebalance(const std::vector<AssetAction>& actions)
+	{
+		struct Trade
+		{
+			unsigned asset;
+			unsigned action;
+			std::future<Result<Position>> position;
+			// signed shares to order
+			double shares = 0.0;
+			double price = 0.0;
+			double minimum = 1.0;
+			long long tick = 0;
+		};
+
+		long long start = monotonic_nanos();
+
+		// the account is requested once for the whole batch, alongside the
+		// positions of every asset that wants to trade
+		std::future<Result<Account>> acc_future;
+		std::vector<Trade> trades;
+		// only the latest action of an asset counts
+		std::vector<int> slots(_assets.size(), -1);
+
+		for (const AssetAction& act : actions)
+		{
+			const Asset& asset = _assets[act.asset];
+			_risk_engine.update_price(act.asset, act.price);
+			_pretrade.set_close(act.asset, act.price);
+
+			switch (act.action)
 			{
 			case ENTER_LONG:
-				_client.enter_long(asset, _risk / risk_sum());
-				update_portfolio = true;
-				break;
-
 			case EXIT_LONG:
-				_client.exit_long(asset);
-				update_portfolio = true;
-				break;
-
 			case ENTER_SHORT:
-				_client.enter_short(asset, _risk / risk_sum());
-				update_portfolio = true;
-				break;
-
 			case EXIT_SHORT:
-				_client.exit_short(asset);
-				update_portfolio = true;
+				if (!acc_future.valid()) acc_future = _client.get_account_async();
+
+				if (slots[act.asset] < 0)
+				{
+					slots[act.asset] = trades.size();
+					trades.push_back({ act.asset, act.action,
+						_client.get_position_async(asset.ticker()) });
+				}
+				else
+				{
+					trades[slots[act.asset]].action = act.action;
+				}
+				trades[slots[act.asset]].tick = act.tick;
 				break;
 
 			case NOTHING:
-				INFO("(%s) $%s: No action taken", _label, asset.ticker());
+				ASYNC_INFO("(%s) $%s: No action taken", _label, asset.ticker());
 				break;
 
 			case ERROR:
@@ -255,13 +536,171 @@ namespace daytrender
 
 			default:
 				ERROR("(%s) $%s: Invalid action received from strategy: %d",
-					_label, asset.ticker(), action);
+					_label, asset.ticker(), act.action);
 				break;
 			}
+		}
 
-			// if an order was placed
-			if (update_portfolio) update();
+		if (trades.empty()) return;
+
+		Result<Account> acc_res = acc_future.get();
+		if (!acc_res)
+		{
+			ERROR("(%s) $%s: %s", _label, _client.filename(), acc_res.error());
+			return;
 		}
+
+		Account acc = acc_res.get();
+		_risk_engine.set_equity(acc.equity());
+		double pct = _risk / risk_sum();
+
+		// targets are netted against what the account holds, which includes
+		// orders placed by other portfolios trading on it
+		std::vector<Trade*> exits, entries;
+		for (Trade& trade : trades)
+		{
+			const Asset& asset = _assets[trade.asset];
+			Result<Position> pos_res = trade.position.get();
+			if (!pos_res)
+			{
+				ERROR("(%s) $%s: %s", _label, asset.ticker(), pos_res.error());
+				continue;
+			}
+
+			Position pos = pos_res.get();
+			double held = pos.shares();
+			_risk_engine.set_shares(trade.asset, held);
+
+			Result<double> shares = rebalance_shares(trade.action, pos, [&](bool short_shares)
+			{
+				return _client.target_shares(asset, pct, short_shares, acc, pos);
+			});
+			if (!shares)
+			{
+				WARNING("(%s) $%s: not rebalanced, %s", _label, asset.ticker(), shares.error());
+				continue;
+			}
+
+			trade.shares = shares.get();
+			double target = held + trade.shares;
+			trade.price = pos.price();
+			trade.minimum = pos.minimum();
+			// the queries were shared, so every asset waited on all of them
+			_latency.record(trade.asset, STAGE_SIZING, monotonic_nanos() - start);
+			if (trade.shares == 0.0) continue;
+
+			// orders that only shrink a position go first to free up margin
+			if (held * target >= 0.0 && std::abs(target) <= std::abs(held))
+			{
+				exits.push_back(&trade);
+			}
+			else
+			{
+				entries.push_back(&trade);
+			}
+		}
+
+		unsigned placed = 0;
+		auto send = [&](const std::vector<Trade*>& batch, bool entering)
+		{
+			std::vector<std::pair<Trade*, std::future<Result<Fill>>>> orders;
+			long long now = EventQueue::epoch_micros();
+			long long sent = monotonic_nanos();
+
+			for (Trade *trade : batch)
+			{
+				const Asset& asset = _assets[trade->asset];
+
+				if (entering)
+				{
+					double allowed = _risk_engine.limit_order(trade->asset, trade->shares);
+					if (allowed != trade->shares)
+					{
+						WARNING("(%s) $%s: risk limits reduced order from %f to %f shares",
+							_label, asset.ticker(), trade->shares, allowed);
+						trade->shares = std::trunc(allowed / trade->minimum) * trade->minimum;
+					}
+					if (trade->shares == 0.0) continue;
+
+					const char *error = _pretrade.check(trade->asset, trade->shares, trade->price,
+						_risk_engine.shares(trade->asset), now);
+					if (error)
+					{
+						count_metric(METRIC_ORDERS_BLOCKED);
+						ERROR("(%s) $%s: %s", _label, asset.ticker(), error);
+						continue;
+					}
+				}
+
+				ASYNC_DEBUG("Placing order for %f shares!!!", trade->shares);
+				orders.emplace_back(trade, _client.market_order_async(asset.ticker(), trade->shares));
+			}
+
+			for (auto& order : orders)
+			{
+				Trade *trade = order.first;
+				Result<Fill> fill = order.second.get();
+
+				// orders finishing while an earlier one is waited on count until then
+				_latency.record(trade->asset, STAGE_ORDER, monotonic_nanos() - sent);
+				if (trade->tick > 0)
+				{
+					_latency.record(trade->asset, STAGE_TICK_TO_ORDER,
+						(EventQueue::epoch_micros() - trade->tick) * 1000);
+				}
+
+				if (!fill)
+				{
+					ERROR("(%s) $%s: %s", _label, _assets[trade->asset].ticker(), fill.error());
+					continue;
+				}
+
+				if (entering) _pretrade.record(trade->asset, trade->shares, now);
+				_risk_engine.add_shares(trade->asset, fill.get().shares());
+				placed += 1;
+			}
+		};
+
+		send(exits, false);
+		send(entries, true);
+
+		// a single account refresh for everything that was placed
+		if (placed > 0) update();
+	}
+
+
+	void Portfolio::update_assets()
+	{
+		TRACE_SPAN("Portfolio::update_assets");
+		ALLOCATION_SCOPE(ALLOC_PORTFOLIO);
+		ASYNC_DEBUG("Updating %s assets", _label);
+
+		// fetching every due asset at once
+		std::vector<std::pair<unsigned, std::future<Result<PriceHistory>>>> fetches;
+		for (unsigned i = 0; i < _assets.size(); ++i)
+		{
+			// skip if it shouldn't update yet
+			if (!_assets[i].should_update()) continue;
+			fetches.emplace_back(i, fetch_asset_async(i));
+		}
+
+		std::vector<AssetAction> actions;
+		for (auto& fetch : fetches)
+		{
+			unsigned i = fetch.first;
+			Result<PriceHistory> res = fetch.second.get();
+			if (!res)
+			{
+				ERROR("(%s) $%s: %s", _label, _assets[i].ticker(), res.error());
+				continue;
+			}
+
+			PriceHistory hist = res.get();
+			actions.push_back({ i, evaluate_asset(i, hist),
+				hist.empty() ? 0.0 : hist.back().close() });
+		}
+
+		execute_actions(actions);
 	}
 
 
@@ -0,0 +1,89 @@
+#include <data/pretradecheck.h>
+
+// standard library
+#include <algorithm>
+#include <cmath>
+
+namespace daytrender
+{
+	// a rate below one order per second still has to reach a whole token
+	static inline double burst(const PreTradeLimits& limits)
+	{
+		return std::max(1.0, limits.max_rate);
+	}
+
+	PreTradeCheck::PreTradeCheck(size_t instruments, const PreTradeLimits& limits) :
+	_instruments(instruments)
+	{
+		for (unsigned i = 0; i < instruments; ++i) set_limits(i, limits);
+	}
+
+	void PreTradeCheck::set_limits(unsigned instrument, const PreTradeLimits& limits)
+	{
+		Instrument& inst = _instruments[instrument];
+		inst.limits = limits;
+		inst.tokens = burst(limits);
+		inst.refilled = 0;
+	}
+
+	const char *PreTradeCheck::check(unsigned instrument, double shares, double price,
+		double position, long long now)
+	{
+		if (instrument >= _instruments.size()) return "order is for an unknown instrument";
+
+		Instrument& inst = _instruments[instrument];
+		const PreTradeLimits& limits = inst.limits;
+
+		if (!std::isfinite(shares) || !std::isfinite(price) || price <= 0.0)
+		{
+			return "order size or price is invalid";
+		}
+
+		if (limits.max_notional > 0.0 && std::abs(shares) * price > limits.max_notional)
+		{
+			return "order value is above the maximum notional";
+		}
+
+		if (limits.max_position > 0.0 && std::abs(position + shares) > limits.max_position
+			&& std::abs(position + shares) > std::abs(position))
+		{
+			return "order would exceed the maximum position";
+		}
+
+		if (limits.max_deviation > 0.0 && inst.last_close > 0.0
+			&& std::abs(price - inst.last_close) > inst.last_close * limits.max_deviation)
+		{
+			return "order price deviates too far from the last close";
+		}
+
+		if (limits.duplicate_window > 0 && inst.last_order > 0 && shares == inst.last_shares
+			&& now - inst.last_order < limits.duplicate_window)
+		{
+			return "order is a duplicate of the previous one";
+		}
+
+		if (limits.max_rate > 0.0)
+		{
+			// refilling here rather than in record so a burst of rejected
+			// checks sees the same tokens
+			if (inst.refilled > 0)
+			{
+				inst.tokens += (double)(now - inst.refilled) * limits.max_rate / 1e6;
+				if (inst.tokens > burst(limits)) inst.tokens = burst(limits);
+			}
+			inst.refilled = now;
+
+			if (inst.tokens < 1.0) return "order rate is above the maximum";
+		}
+
+		return nullptr;
+	}
+
+	void PreTradeCheck::record(unsigned instrument, double shares, long long now)
+	{
+		Instrument& inst = _instruments[instrument];
+		if (inst.limits.max_rate > 0.0) inst.tokens -= 1.0;
+		inst.last_shares = shares;
+		inst.last_order = now;
+	}
+}
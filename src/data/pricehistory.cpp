@@ -17,6 +17,8 @@ namespace daytrender
 		
 		_slice = other._slice;
 
+		other._data = nullptr;
+		other._size = 0;
 		other._slice = true;
 	}
 
@@ -44,8 +46,12 @@ namespace daytrender
 
 	PriceHistory& PriceHistory::operator=(const PriceHistory& other)
 	{
+		if (this == &other) return *this;
+		if (!_slice) delete[] _data;
+
 		_interval = other.interval();
 		_size = other.size();
+		_slice = false;
 		_data = new Candle[_size];
 
 		for (int i = 0; i < _size; i++)
@@ -55,4 +61,21 @@ namespace daytrender
 	
 		return *this;
 	}
+
+	PriceHistory& PriceHistory::operator=(PriceHistory&& other)
+	{
+		if (this == &other) return *this;
+		if (!_slice) delete[] _data;
+
+		_data = other._data;
+		_size = other._size;
+		_interval = other._interval;
+		_slice = other._slice;
+
+		other._data = nullptr;
+		other._size = 0;
+		other._slice = true;
+
+		return *this;
+	}
 }
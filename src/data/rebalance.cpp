@@ -0,0 +1,37 @@
+#include <data/rebalance.h>
+
+// local includes
+#include <api/action.h>
+
+// standard library
+#include <cmath>
+
+namespace daytrender
+{
+	Result<double> rebalance_shares(unsigned action, const Position& pos,
+		const std::function<double(bool)>& target)
+	{
+		double held = pos.shares();
+		double shares = held;
+
+		switch (action)
+		{
+		case ENTER_LONG:
+		case ENTER_SHORT:
+			// an entry without a price would be sized to nothing, selling what is held
+			if (pos.price() <= 0.0) return "no price is known for the instrument yet";
+			shares = target(action == ENTER_SHORT);
+			break;
+
+		case EXIT_LONG:
+			if (held > 0.0) shares = 0.0;
+			break;
+
+		case EXIT_SHORT:
+			if (held < 0.0) shares = 0.0;
+			break;
+		}
+
+		return std::trunc((shares - held) / pos.minimum()) * pos.minimum();
+	}
+}
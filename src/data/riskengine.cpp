@@ -0,0 +1,226 @@
+#include <data/riskengine.h>
+
+// standard library
+#include <algorithm>
+#include <cmath>
+
+namespace daytrender
+{
+	RiskEngine::RiskEngine(const std::vector<std::string>& tickers, const RiskLimits& limits,
+		double decay) :
+	_limits(limits),
+	_decay(decay),
+	_shares(tickers.size(), 0.0),
+	_prices(tickers.size(), 0.0),
+	_returns(tickers.size(), 0.0),
+	_weights(tickers.size(), 0.0),
+	_base(tickers.size(), -1),
+	_quote(tickers.size(), -1),
+	_cov(tickers.size() * tickers.size(), 0.0),
+	_cov_weights(tickers.size(), 0.0)
+	{
+		for (unsigned i = 0; i < tickers.size(); ++i)
+		{
+			const std::string& ticker = tickers[i];
+			size_t sep = ticker.find_first_of("_/");
+
+			if (sep == std::string::npos)
+			{
+				_base[i] = currency_index(ticker);
+			}
+			else
+			{
+				_base[i] = currency_index(ticker.substr(0, sep));
+				_quote[i] = currency_index(ticker.substr(sep + 1));
+			}
+		}
+	}
+
+	int RiskEngine::currency_index(const std::string& currency)
+	{
+		for (unsigned i = 0; i < _currencies.size(); ++i)
+		{
+			if (_currencies[i] == currency) return i;
+		}
+
+		_currencies.push_back(currency);
+		_exposure.push_back(0.0);
+		return _currencies.size() - 1;
+	}
+
+	void RiskEngine::update_price(unsigned asset, double price)
+	{
+		if (price <= 0.0) return;
+
+		if (_prices[asset] > 0.0)
+		{
+			double ret = std::log(price / _prices[asset]);
+			update_covariance(asset, ret);
+			_returns[asset] = ret;
+		}
+
+		_prices[asset] = price;
+		set_weight(asset, _shares[asset] * price);
+
+		// keeping rounding errors of the incremental updates from adding up
+		_updates += 1;
+		if (_updates % RISK_RECALC_INTERVAL == 0) recalculate();
+	}
+
+	void RiskEngine::add_shares(unsigned asset, double shares)
+	{
+		set_shares(asset, _shares[asset] + shares);
+	}
+
+	void RiskEngine::set_shares(unsigned asset, double shares)
+	{
+		_shares[asset] = shares;
+		set_weight(asset, shares * _prices[asset]);
+	}
+
+	void RiskEngine::set_weight(unsigned asset, double weight)
+	{
+		double delta = weight - _weights[asset];
+		if (delta == 0.0) return;
+
+		_gross += std::abs(weight) - std::abs(_weights[asset]);
+		_net += delta;
+		if (_base[asset] >= 0) _exposure[_base[asset]] += delta;
+		if (_quote[asset] >= 0) _exposure[_quote[asset]] -= delta;
+
+		// (w + d)' C (w + d) = w'Cw + 2d(Cw)_i + d^2 C_ii
+		_variance += 2.0 * delta * _cov_weights[asset] + delta * delta * cov(asset, asset);
+		for (unsigned j = 0; j < _weights.size(); ++j)
+		{
+			_cov_weights[j] += cov(j, asset) * delta;
+		}
+
+		_weights[asset] = weight;
+	}
+
+	void RiskEngine::update_covariance(unsigned asset, double ret)
+	{
+		// only the row and column of this asset change, each paired with the
+		// latest return of the other asset
+		double weight = _weights[asset];
+		double cov_weight_delta = 0.0;
+		double variance_delta = 0.0;
+
+		for (unsigned j = 0; j < _weights.size(); ++j)
+		{
+			double other = (j == asset) ? ret : _returns[j];
+			double prev = cov(asset, j);
+			double next = _decay * prev + (1.0 - _decay) * ret * other;
+			double delta = next - prev;
+
+			cov(asset, j) = next;
+			cov(j, asset) = next;
+
+			cov_weight_delta += delta * _weights[j];
+			if (j == asset)
+			{
+				variance_delta += delta * weight * weight;
+			}
+			else
+			{
+				_cov_weights[j] += delta * weight;
+				variance_delta += 2.0 * delta * weight * _weights[j];
+			}
+		}
+
+		_cov_weights[asset] += cov_weight_delta;
+		_variance += variance_delta;
+	}
+
+	void RiskEngine::recalculate()
+	{
+		_variance = 0.0;
+		for (unsigned i = 0; i < _weights.size(); ++i)
+		{
+			double sum = 0.0;
+			for (unsigned j = 0; j < _weights.size(); ++j)
+			{
+				sum += cov(i, j) * _weights[j];
+			}
+			_cov_weights[i] = sum;
+			_variance += _weights[i] * sum;
+		}
+	}
+
+	double RiskEngine::value_at_risk() const
+	{
+		return RISK_VAR_Z * std::sqrt(std::max(_variance, 0.0));
+	}
+
+	double RiskEngine::volatility(unsigned asset) const
+	{
+		return std::sqrt(cov(asset, asset));
+	}
+
+	double RiskEngine::limit_order(unsigned asset, double shares) const
+	{
+		if (shares == 0.0) return 0.0;
+		if (_limits.gross <= 0.0 && _limits.net <= 0.0 && _limits.currency <= 0.0
+			&& _limits.var <= 0.0) return shares;
+
+		// orders can't be checked before the account and price are known
+		if (_equity <= 0.0 || _prices[asset] <= 0.0) return 0.0;
+
+		double weight = _weights[asset];
+		double order_value = shares * _prices[asset];
+		int base = _base[asset];
+		int quote = _quote[asset];
+
+		// a limit that is already exceeded may not be exceeded further
+		double max_gross = std::max(_limits.gross * _equity, _gross);
+		double max_net = std::max(_limits.net * _equity, std::abs(_net));
+		double max_base = base >= 0 ? std::max(_limits.currency * _equity, std::abs(_exposure[base])) : 0.0;
+		double max_quote = quote >= 0 ? std::max(_limits.currency * _equity, std::abs(_exposure[quote])) : 0.0;
+		double max_var = std::max(_limits.var * _equity, value_at_risk());
+
+		// every measure is convex in the portion of the order placed, so the
+		// allowed portions form an interval starting at 0
+		auto allowed = [&](double portion)
+		{
+			double delta = portion * order_value;
+
+			if (_limits.gross > 0.0
+				&& _gross - std::abs(weight) + std::abs(weight + delta) > max_gross) return false;
+
+			if (_limits.net > 0.0 && std::abs(_net + delta) > max_net) return false;
+
+			if (_limits.currency > 0.0)
+			{
+				if (base >= 0 && std::abs(_exposure[base] + delta) > max_base) return false;
+				if (quote >= 0 && std::abs(_exposure[quote] - delta) > max_quote) return false;
+			}
+
+			if (_limits.var > 0.0)
+			{
+				double variance = _variance + 2.0 * delta * _cov_weights[asset]
+					+ delta * delta * cov(asset, asset);
+				if (RISK_VAR_Z * std::sqrt(std::max(variance, 0.0)) > max_var) return false;
+			}
+
+			return true;
+		};
+
+		if (allowed(1.0)) return shares;
+
+		double low = 0.0, high = 1.0;
+		for (unsigned i = 0; i < 32; ++i)
+		{
+			double mid = (low + high) / 2.0;
+			if (allowed(mid))
+			{
+				low = mid;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+
+		return shares * low;
+	}
+}
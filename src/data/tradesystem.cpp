@@ -3,10 +3,14 @@
 // local inlcudes
 #include <interface/backtest.h>
 #include <interface/shell.h>
-//#include <interface/server.h>
+#include <interface/server.h>
+#include <util/allocations.h>
+#include <util/asynclog.h>
+#include <util/trace.h>
 
 // standard libararies
 #include <filesystem>
+#include <fstream>
 #include <thread>
 #include <mutex>
 
@@ -19,10 +23,15 @@
 using namespace hirzel;
 
 #define CONFIG_FOLDER "/config"
+#define LATENCY_FOLDER "/latency"
+#define TRACE_FOLDER "/traces"
+// milliseconds between checks for stuck portfolios
+#define WATCHDOG_INTERVAL 1000
 
 namespace daytrender
 {
-	TradeSystem::TradeSystem(const std::string& dir)
+	TradeSystem::TradeSystem(const std::string& dir) :
+	_dir(dir)
 	{
 		_initialized = init(dir);
 		if (!_initialized) _portfolios.clear();
@@ -59,6 +68,35 @@ namespace daytrender
 		for (auto pair : table)
 		{
 			const std::string& label = pair.first;
+
+			// entries that aren't filenames configure the trade system itself
+			if (!pair.second.is_string())
+			{
+				if (label == "low_latency")
+				{
+					if (!init_low_latency(pair.second)) return false;
+				}
+				else if (label == "server")
+				{
+					if (!server::init(pair.second, *this, dir)) return false;
+					_serving = true;
+				}
+				else if (label == "allocations")
+				{
+					if (!init_allocations(pair.second)) return false;
+				}
+				else if (label == "trace")
+				{
+					set_tracing(pair.second.to_uint() != 0);
+					if (is_tracing()) SUCCESS("Tracing is enabled");
+				}
+				else
+				{
+					WARNING("portfolios.json: ignoring unknown setting '%s'", label);
+				}
+				continue;
+			}
+
 			std::string filename = pair.second.to_string();
 			
 			std::string file = file::read(dir + CONFIG_FOLDER "/portfolios/" + filename);
@@ -93,36 +131,338 @@ namespace daytrender
 		return true;
 	}
 
+	bool TradeSystem::init_low_latency(const Data& config)
+	{
+		if (!config.is_table())
+		{
+			FATAL("low_latency must be an object");
+			return false;
+		}
+
+		const char *core_lists[] = { "evaluate_cores", "execute_cores" };
+		std::vector<int> *cores[] = { &_low_latency.evaluate_cores, &_low_latency.execute_cores };
+
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			if (!config.contains(core_lists[i])) continue;
+
+			const Data& list = config[core_lists[i]];
+			if (!list.is_array())
+			{
+				FATAL("low_latency: %s must be an array of core numbers", core_lists[i]);
+				return false;
+			}
+
+			for (unsigned j = 0; j < list.size(); ++j)
+			{
+				cores[i]->push_back(list[j].to_int());
+			}
+		}
+
+		if (config.contains("dispatch_core"))
+		{
+			_low_latency.dispatch_core = config["dispatch_core"].to_int();
+		}
+
+		if (config.contains("spin"))
+		{
+			_low_latency.spin_micros = config["spin"].to_uint();
+		}
+
+		_low_latency.enabled = true;
+		SUCCESS("Low latency mode is enabled");
+
+		return true;
+	}
+
+	bool TradeSystem::init_allocations(const Data& config)
+	{
+		if (!config.is_table())
+		{
+			FATAL("allocations must be an object");
+			return false;
+		}
+
+		if (config.contains("count") && config["count"].to_uint() != 0)
+		{
+			set_allocation_accounting(true);
+			SUCCESS("Allocation accounting is enabled");
+		}
+
+		if (config.contains("steady_state_after"))
+		{
+			_steady_state_after = config["steady_state_after"].to_uint();
+		}
+
+		return true;
+	}
+
+	void TradeSystem::apply_low_latency()
+	{
+		const char *error;
+		for (unsigned i = 0; i < _low_latency.evaluate_cores.size(); ++i)
+		{
+			error = pin_thread(_pool->thread(i), _low_latency.evaluate_cores[i]);
+			if (error) WARNING("evaluate thread %u: %s", i, error);
+		}
+
+		const std::vector<int>& execute_cores = _low_latency.execute_cores;
+		for (unsigned i = 0; i < _pipelines.size() && !execute_cores.empty(); ++i)
+		{
+			error = pin_thread(_pipelines[i]->execute_thread(), execute_cores[i % execute_cores.size()]);
+			if (error) WARNING("%s execute thread: %s", _portfolios[i].label(), error);
+		}
+
+		if (_low_latency.dispatch_core >= 0)
+		{
+			error = pin_current_thread(_low_latency.dispatch_core);
+			if (error) WARNING("dispatch thread: %s", error);
+		}
+
+		// after every thread is started so their stacks are locked as well
+		error = lock_memory();
+		if (error) WARNING("%s", error);
+
+		_events.set_spin(_low_latency.spin_micros);
+	}
+
+	void TradeSystem::schedule_asset(unsigned portfolio, unsigned asset, long long now)
+	{
+		const Portfolio& p = _portfolios[portfolio];
+		long long time = p.assets()[asset].next_close(now) + p.update_offset();
+		_events.push({ time, portfolio, (int)asset });
+	}
+
+	void TradeSystem::supervise(long long now)
+	{
+		for (unsigned i = 0; i < _pipelines.size(); ++i)
+		{
+			long long busy = _pipelines[i]->busy_for(now);
+			bool stalled = busy > (long long)_portfolios[i].timeout() * 1000;
+
+			if (stalled && !_stalled[i])
+			{
+				ERROR("%s portfolio has been stuck on an update for %lldms",
+					_portfolios[i].label(), busy);
+			}
+			else if (!stalled && _stalled[i])
+			{
+				INFO("%s portfolio has recovered", _portfolios[i].label());
+			}
+
+			_stalled[i] = stalled;
+		}
+	}
+
+	void TradeSystem::dump_latency() const
+	{
+		std::error_code err;
+		std::filesystem::create_directories(_dir + LATENCY_FOLDER, err);
+		if (err)
+		{
+			ERROR("failed to create latency folder: %s", err.message());
+			return;
+		}
+
+		for (const Portfolio& portfolio : _portfolios)
+		{
+			const LatencyTracker& latency = portfolio.latency();
+			std::string out;
+
+			for (unsigned stage = 0; stage < STAGE_COUNT; ++stage)
+			{
+				LatencyHistogram merged = latency.merged(stage);
+				if (merged.count() == 0) continue;
+
+				INFO("%s %s latency: %s", portfolio.label(), stage_name(stage), merged.to_string());
+				out += "# " + portfolio.label() + " " + stage_name(stage) + ": " + merged.to_string() + "\n";
+				out += merged.distribution();
+
+				for (unsigned i = 0; i < latency.assets(); ++i)
+				{
+					const LatencyHistogram& hist = latency.histogram(i, stage);
+					if (hist.count() == 0) continue;
+
+					out += "# $" + portfolio.assets()[i].ticker() + " " + stage_name(stage) + ": "
+						+ hist.to_string() + "\n";
+					out += hist.distribution();
+				}
+			}
+
+			std::string filepath = _dir + LATENCY_FOLDER "/" + portfolio.label() + ".hgrm";
+			std::ofstream stream(filepath);
+			if (!(stream << out))
+			{
+				ERROR("failed to write %s", filepath);
+			}
+		}
+	}
+
+	void TradeSystem::dump_trace() const
+	{
+		std::error_code err;
+		std::filesystem::create_directories(_dir + TRACE_FOLDER, err);
+		if (err)
+		{
+			ERROR("failed to create traces folder: %s", err.message());
+			return;
+		}
+
+		std::string filepath = _dir + TRACE_FOLDER "/"
+			+ std::to_string(EventQueue::epoch_millis()) + ".json";
+		const char *error = write_trace(filepath);
+		if (error)
+		{
+			ERROR("%s: %s", filepath, error);
+			return;
+		}
+
+		INFO("Wrote trace to %s", filepath);
+	}
+
+	void TradeSystem::dump_allocations() const
+	{
+		if (!is_accounting_allocations()) return;
+
+		uint64_t totals[METRIC_COUNT];
+		collect_metrics(totals);
+
+		for (unsigned i = 0; i < ALLOC_SUBSYSTEM_COUNT; ++i)
+		{
+			INFO("%s allocations: %llu (%llu bytes)", alloc_subsystem_name(i),
+				(unsigned long long)totals[METRIC_ALLOCATIONS + i],
+				(unsigned long long)totals[METRIC_ALLOCATED_BYTES + i]);
+		}
+
+		if (_steady_state_after > 0)
+		{
+			INFO("Allocations in steady state ticks: %llu",
+				(unsigned long long)totals[METRIC_STEADY_STATE_ALLOCATIONS]);
+		}
+	}
+
 	void TradeSystem::start()
 	{
+		_events.clear();
 		_running = true;
+		set_steady_state(false);
+		unsigned long long dispatched = 0;
+
+		// every portfolio is updated by its own pipeline so that a slow broker
+		// only delays the portfolios using it and strategies never delay orders
+		_mtx.lock();
+		_pipelines.clear();
+		_stalled.assign(_portfolios.size(), false);
+		// in low latency mode there is one evaluation thread per configured core
+		_pool = std::make_unique<ThreadPool>(_low_latency.enabled
+			? _low_latency.evaluate_cores.size() : 0);
+		unsigned spin = _low_latency.enabled ? LOW_LATENCY_SPIN_COUNT : PARKER_SPIN_COUNT;
+		for (Portfolio& portfolio : _portfolios)
+		{
+			_pipelines.push_back(std::make_unique<Pipeline>(portfolio, *_pool, spin));
+		}
+		_mtx.unlock();
+
+		_jitter = {};
+		if (_low_latency.enabled) apply_low_latency();
+
+		if (_serving) _server_thread = std::thread(server::start);
+
 		SUCCESS("Trade system has started");
 
-		while (_running)
+		// every portfolio updates right away and every asset at its next candle close
+		long long now = EventQueue::epoch_millis();
+		_events.push({ now + WATCHDOG_INTERVAL, 0, Event::WATCHDOG });
+		for (unsigned i = 0; i < _portfolios.size(); ++i)
 		{
-			for (Portfolio& portfolio : _portfolios)
+			_events.push({ now, i, Event::PORTFOLIO });
+			for (unsigned j = 0; j < _portfolios[i].assets().size(); ++j)
 			{
-				// do nothing if portfolio is not live
-				if (!portfolio.is_live())
-				{
-					DEBUG("%s portfolio is not live and cannot be updated",
-						portfolio.label());
-					continue;
-				}
-				// update account/ pl info if hasn't been done recently
-				if (portfolio.should_update()) portfolio.update();
-				// update assets
-				portfolio.update_assets();
+				schedule_asset(i, j, now);
+			}
+		}
+
+		// the main thread only dispatches events and supervises the pipelines
+		Event event;
+		while (_events.wait(event))
+		{
+			long long late = EventQueue::epoch_micros() - event.time * 1000;
+			_jitter.record(late);
+			count_metric(METRIC_SCHEDULER_EVENTS);
+			count_metric(METRIC_SCHEDULER_LAG_NANOS, late > 0 ? late * 1000 : 0);
+			now = EventQueue::epoch_millis();
+
+			TRACE_SPAN("TradeSystem::dispatch");
+
+			if (event.asset == Event::WATCHDOG)
+			{
+				supervise(now);
+				if (take_trace_request()) dump_trace();
+				_events.push({ event.time + WATCHDOG_INTERVAL, 0, Event::WATCHDOG });
+				continue;
+			}
+
+			Portfolio& portfolio = _portfolios[event.portfolio];
+			ASYNC_DEBUG("%s event fired %lldms late", portfolio.label(), now - event.time);
+			if (event.asset >= 0)
+			{
+				portfolio.latency().record(event.asset, STAGE_WAKEUP, late * 1000);
+			}
+
+			// rescheduling before the update so its duration doesn't delay the next one
+			if (event.asset == Event::PORTFOLIO)
+			{
+				_events.push({ event.time + PORTFOLIO_UPDATE_INTERVAL * 1000, event.portfolio,
+					Event::PORTFOLIO });
+			}
+			else
+			{
+				schedule_asset(event.portfolio, event.asset, now);
+			}
+
+			if (!_pipelines[event.portfolio]->push(event))
+			{
+				ASYNC_WARNING("%s portfolio is behind and skipped an update", portfolio.label());
+			}
+
+			// by now every cache and buffer of the tick should have grown to size
+			if (event.asset >= 0 && ++dispatched == _steady_state_after)
+			{
+				set_steady_state(true);
+				INFO("Reached steady state after %llu events, reporting allocations in ticks",
+					dispatched);
 			}
-			
-			// check all portfolios every 3 seconds
-			sys::sleep_millis(3000);
 		}
+
+		if (_server_thread.joinable())
+		{
+			server::stop();
+			_server_thread.join();
+		}
+
+		// waits for updates in progress to finish
+		for (auto& pipeline : _pipelines)
+		{
+			pipeline->stop();
+			pipeline->report();
+		}
+		_mtx.lock();
+		_pipelines.clear();
+		_mtx.unlock();
+		_pool.reset();
+
+		if (_low_latency.enabled) INFO("Wakeup jitter: %s", _jitter.to_string());
+		dump_latency();
+		if (is_tracing()) dump_trace();
+		set_steady_state(false);
+		dump_allocations();
+
+		_running = false;
 	}
 
 	void TradeSystem::stop()
 	{
-		_mtx.lock();
+		std::lock_guard<std::mutex> lock(_mtx);
 		if (!_running)
 		{
 			WARNING("DayTrender has already stopped");
@@ -130,9 +470,9 @@ namespace daytrender
 		}
 
 		_running = false;
+		_events.stop();
 		PRINT("\r"); // covering up ^C from interrupt
 		INFO("Shutting down trade system...");
-		_mtx.unlock();
 	}
 
 	Portfolio *TradeSystem::get_portfolio(const std::string& label)
@@ -143,4 +483,24 @@ namespace daytrender
 		}
 		return nullptr;
 	}
+
+	std::vector<QueueMetrics> TradeSystem::queue_metrics()
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		std::vector<QueueMetrics> out;
+
+		for (unsigned i = 0; i < _pipelines.size(); ++i)
+		{
+			const Pipeline& pipeline = *_pipelines[i];
+			const RingMetrics& candles = pipeline.candle_metrics();
+			const RingMetrics& signals = pipeline.signal_metrics();
+
+			out.push_back({ _portfolios[i].label(), "candles", pipeline.candle_depth(),
+				pipeline.candle_capacity(), candles.high_water(), candles.pushed(), candles.rejected() });
+			out.push_back({ _portfolios[i].label(), "signals", pipeline.signal_depth(),
+				pipeline.signal_capacity(), signals.high_water(), signals.pushed(), signals.rejected() });
+		}
+
+		return out;
+	}
 }
@@ -0,0 +1,67 @@
+#include <data/worker.h>
+
+namespace daytrender
+{
+	Worker::Worker(std::function<void(const std::vector<Event>&)> handler) :
+	_handler(handler),
+	_busy_since(0)
+	{
+		_thread = std::thread(&Worker::run, this);
+	}
+
+	Worker::~Worker()
+	{
+		stop();
+	}
+
+	void Worker::run()
+	{
+		std::vector<Event> batch;
+		batch.reserve(WORKER_QUEUE_CAPACITY);
+
+		std::unique_lock<std::mutex> lock(_mtx);
+		while (true)
+		{
+			_cv.wait(lock, [&]() { return !_running || !_queue.empty(); });
+			if (!_running) break;
+
+			batch.assign(_queue.begin(), _queue.end());
+			_queue.clear();
+			lock.unlock();
+
+			_busy_since.store(EventQueue::epoch_millis(), std::memory_order_relaxed);
+			_handler(batch);
+			_busy_since.store(0, std::memory_order_relaxed);
+
+			lock.lock();
+		}
+	}
+
+	bool Worker::push(const Event& event)
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		if (!_running || _queue.size() >= WORKER_QUEUE_CAPACITY) return false;
+
+		for (const Event& queued : _queue)
+		{
+			if (queued.asset == event.asset) return false;
+		}
+
+		_queue.push_back(event);
+		lock.unlock();
+		_cv.notify_one();
+
+		return true;
+	}
+
+	void Worker::stop()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		_running = false;
+		_queue.clear();
+		lock.unlock();
+		_cv.notify_one();
+
+		if (_thread.joinable()) _thread.join();
+	}
+}
@@ -1,40 +1,74 @@
-#include "server.h"
+#include <interface/server.h>
 
-#include "interface.h"
-#include "../daytrender.h"
-#include "../api/asset.h"
+// local includes
+#include <data/tradesystem.h>
+#include <interface/backtest.h>
+#include <util/allocations.h>
+#include <util/latency.h>
+#include <util/metrics.h>
+#include <util/trace.h>
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
 #include <mutex>
 #include <string>
+#include <vector>
 
+// external libraries
 #include <httplib.h>
+#include <hirzel/logger.h>
+#include <zlib.h>
 
-#include <hirzel/fountain.h>
+#ifdef DAYTRENDER_BROTLI
+#include <brotli/encode.h>
+#endif
 
 #define JSON_FORMAT	"application/json"
 #define TEXT_FORMAT "text/plain"
+#define METRICS_FORMAT "text/plain; version=0.0.4"
+// balance backtests from the interface start with
+#define BACKTEST_PRINCIPAL 500.0
+#define HTML_FORMAT "text/html; charset=utf-8"
 
-#define READ_INTERFACE_ON_STARTUP
-
-#ifdef READ_INTERFACE_ON_STARTUP
-#include <hirzel/fileutil.h>
-#endif
-
-using Json = picojson::value;
+// browsers keep the interface but check it is current with its etag
+#define INTERFACE_CACHE_CONTROL "no-cache"
 
 namespace daytrender
 {
 	namespace server
 	{
 		httplib::Server server;
-		std::string ip, username, password;
-		std::string html
-		#ifndef READ_INTERFACE_ON_STARTUP
+		TradeSystem *trade_system = nullptr;
+		std::string ip, dir;
+
+		/**
+		 * A file embedded at build time, compressed once so that serving it
+		 * is only a copy.
+		 */
+		struct EmbeddedFile
 		{
+			struct Encoding
+			{
+				// empty if the encoding isn't smaller or isn't available
+				std::string body;
+				// every encoding is a different representation with its own tag
+				std::string etag;
+			};
+
+			const char *type;
+			Encoding identity;
+			Encoding gzip;
+			Encoding brotli;
+		};
+
+		const char webinterface[] =
 			#include "webinterface.inc"
-		}
-		#endif
 		;
-		
+		EmbeddedFile interface_file;
+
 		unsigned short port;
 		bool running = false;
 		std::mutex mtx;
@@ -45,20 +79,197 @@ namespace daytrender
 		void get_watch(const httplib::Request& req,  httplib::Response& res);
 		void get_backtest(const httplib::Request& req,  httplib::Response& res);
 		void get_accinfo(const httplib::Request& req,  httplib::Response& res);
+		void get_metrics(const httplib::Request& req,  httplib::Response& res);
+		void get_trace(const httplib::Request& req,  httplib::Response& res);
+
+		// registers a handler whose allocations are counted for the server
+		static void route(const char *path, void (*handler)(const httplib::Request&, httplib::Response&))
+		{
+			server.Get(path, [handler](const httplib::Request& req, httplib::Response& res)
+			{
+				ALLOCATION_SCOPE(ALLOC_SERVER);
+				handler(req, res);
+			});
+		}
+
+		static std::string gzip_compress(const std::string& in)
+		{
+			z_stream stream = {};
+			// 16 added to the window bits writes a gzip header instead of zlib's
+			if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+				Z_DEFAULT_STRATEGY) != Z_OK)
+			{
+				return "";
+			}
+
+			std::string out(deflateBound(&stream, in.size()), '\0');
+			stream.next_in = (Bytef*)in.data();
+			stream.avail_in = (uInt)in.size();
+			stream.next_out = (Bytef*)&out[0];
+			stream.avail_out = (uInt)out.size();
+
+			int status = deflate(&stream, Z_FINISH);
+			out.resize(stream.total_out);
+			deflateEnd(&stream);
+
+			return status == Z_STREAM_END ? out : "";
+		}
+
+		static std::string brotli_compress(const std::string& in)
+		{
+		#ifdef DAYTRENDER_BROTLI
+			std::string out(BrotliEncoderMaxCompressedSize(in.size()), '\0');
+			size_t size = out.size();
+			if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+				in.size(), (const uint8_t*)in.data(), &size, (uint8_t*)&out[0]))
+			{
+				return "";
+			}
+			out.resize(size);
+			return out;
+		#else
+			(void)in;
+			return "";
+		#endif
+		}
+
+		static EmbeddedFile embed(const char *content, const char *type)
+		{
+			EmbeddedFile file;
+			file.type = type;
+			file.identity.body = content;
+
+			// the etag only has to change with the content, so a hash of it will do
+			unsigned long long hash = 14695981039346656037ULL;
+			for (char c : file.identity.body)
+			{
+				hash ^= (unsigned char)c;
+				hash *= 1099511628211ULL;
+			}
+			char etag[40];
+			snprintf(etag, sizeof(etag), "\"%016llx\"", hash);
+			file.identity.etag = etag;
+			snprintf(etag, sizeof(etag), "\"%016llx-gzip\"", hash);
+			file.gzip.etag = etag;
+			snprintf(etag, sizeof(etag), "\"%016llx-br\"", hash);
+			file.brotli.etag = etag;
+
+			file.gzip.body = gzip_compress(file.identity.body);
+			if (file.gzip.body.size() >= file.identity.body.size()) file.gzip.body.clear();
+			file.brotli.body = brotli_compress(file.identity.body);
+			if (file.brotli.body.size() >= file.identity.body.size()) file.brotli.body.clear();
+
+			return file;
+		}
+
+		// calls func with every trimmed element of a comma separated header
+		template <typename F>
+		static bool any_element(const std::string& header, F func)
+		{
+			size_t start = 0;
+			while (start < header.size())
+			{
+				size_t end = header.find(',', start);
+				if (end == std::string::npos) end = header.size();
+
+				size_t first = header.find_first_not_of(" \t", start);
+				size_t last = header.find_last_not_of(" \t", end - 1);
+				if (first < end && last != std::string::npos && last >= first)
+				{
+					if (func(header.substr(first, last - first + 1))) return true;
+				}
+
+				start = end + 1;
+			}
+
+			return false;
+		}
+
+		/**
+		 * @return	whether an Accept-Encoding header allows the coding
+		 */
+		static bool accepts_encoding(const std::string& header, const char *coding)
+		{
+			return any_element(header, [&](const std::string& element)
+			{
+				size_t params = element.find(';');
+				if (element.compare(0, params, coding) != 0) return false;
+				if (params == std::string::npos) return true;
+
+				// a quality of 0 refuses the coding
+				size_t quality = element.find("q=", params);
+				return quality == std::string::npos || atof(element.c_str() + quality + 2) > 0.0;
+			});
+		}
+
+		/**
+		 * @return	whether an If-None-Match header names the etag
+		 */
+		static bool matches_etag(const std::string& header, const std::string& etag)
+		{
+			return any_element(header, [&](const std::string& element)
+			{
+				// weak comparison, which is what conditional GETs use
+				if (element == "*") return true;
+				return element == etag || (element.compare(0, 2, "W/") == 0
+					&& element.compare(2, std::string::npos, etag) == 0);
+			});
+		}
+
+		static void serve(const httplib::Request& req, httplib::Response& res,
+			const EmbeddedFile& file)
+		{
+			std::string accepted = req.get_header_value("Accept-Encoding");
+			const EmbeddedFile::Encoding *encoding = &file.identity;
+			const char *name = nullptr;
+			if (!file.brotli.body.empty() && accepts_encoding(accepted, "br"))
+			{
+				encoding = &file.brotli;
+				name = "br";
+			}
+			else if (!file.gzip.body.empty() && accepts_encoding(accepted, "gzip"))
+			{
+				encoding = &file.gzip;
+				name = "gzip";
+			}
+
+			res.set_header("ETag", encoding->etag);
+			res.set_header("Cache-Control", INTERFACE_CACHE_CONTROL);
+			res.set_header("Vary", "Accept-Encoding");
+
+			// only the representation that would be sent is compared
+			if (matches_etag(req.get_header_value("If-None-Match"), encoding->etag))
+			{
+				res.status = 304;
+				return;
+			}
 
-		bool init(const Json& config, const std::string& dir)
+			if (name) res.set_header("Content-Encoding", name);
+			res.set_content(encoding->body.data(), encoding->body.size(), file.type);
+		}
+
+		bool init(const hirzel::Data& config, TradeSystem& system, const std::string& dir)
 		{
-			ip = config.get("ip").get<std::string>();
-			port = (unsigned short)config.get("port").get<double>();
-			username = config.get("username").get<std::string>();
-			password = config.get("password").get<std::string>();
-
-			server.Get("/", get_root);
-			server.Get("/data", get_data);
-			server.Get("/shutdown", get_shutdown);
-			server.Get("/watch", get_watch);
-			server.Get("/backtest", get_backtest);
-			server.Get("/accinfo", get_accinfo);
+			if (!config.is_table() || !config.contains("ip") || !config.contains("port"))
+			{
+				FATAL("server must be an object with an ip and port");
+				return false;
+			}
+
+			ip = config["ip"].to_string();
+			port = (unsigned short)config["port"].to_uint();
+			server::dir = dir;
+			trade_system = &system;
+			interface_file = embed(webinterface, HTML_FORMAT);
+
+			route("/", get_root);
+			route("/data", get_data);
+			route("/shutdown", get_shutdown);
+			route("/watch", get_watch);
+			route("/backtest", get_backtest);
+			route("/accinfo", get_accinfo);
+			route("/metrics", get_metrics);
+			route("/trace", get_trace);
 			return true;
 		}
 
@@ -101,219 +312,571 @@ namespace daytrender
 			mtx.unlock();
 		}
 
+		// escapes a string for use in json or as a metric label value
+		static std::string quote(const std::string& str)
+		{
+			std::string out = "\"";
+			for (char c : str)
+			{
+				switch (c)
+				{
+				case '"':
+					out += "\\\"";
+					break;
+				case '\\':
+					out += "\\\\";
+					break;
+				case '\n':
+					out += "\\n";
+					break;
+				default:
+					out += c;
+					break;
+				}
+			}
+			out += '"';
+
+			return out;
+		}
+
 		void get_root(const httplib::Request& req,  httplib::Response& res)
 		{
 			DEBUG("Server GET @ %s", req.path);
-			#ifdef READ_INTERFACE_ON_STARTUP
-			html = hirzel::file::read_file_as_string("./webinterface.html");
-			#endif
-			res.set_content(html, "text/html");
+			serve(req, res, interface_file);
 		}
 
 		void get_data(const httplib::Request& req,  httplib::Response& res)
 		{
 			DEBUG("Server GET @ %s", req.path);
 
-			Json json;
-
-			// gathering strategy names
-			// auto strat_info = strategy_names();
-			// if(strat_info.empty())
-			// {
-			// 	WARNING("No strategy names were received");
-			// }
-			// else
-			// {
-			// 	for (int i = 0; i < strat_info.size(); i++)
-			// 	{
-			// 		response["strategy"][i] = strat_info[i];
-			// 	}
-			// }
-			// gathering asset types and tickers
-			// auto asset_data = asset_names();
-			// if (asset_data.empty())
-			// {
-			// 	WARNING("No asset data was received");
-			// }
-			// else
-			// {
-			// 	for (int i = 0; i < asset_data.size(); i++)
-			// 	{
-			// 		response["assets"][i]["ticker"] = asset_data[i].first;
-			// 		response["assets"][i]["type"] = asset_data[i].second;
-			// 	}
-			// }
-
-			// auto client_data = client_names();
-			// for (int i = 0; i < client_data.size(); i++)
-			// {
-			// 	response["types"][i] = client_data[i];
-			// }
-
-			// sending json object to client
-			res.set_content(json.serialize(), JSON_FORMAT);
+			std::string json = "{\"portfolios\":[";
+			const std::vector<Portfolio>& portfolios = trade_system->get_portfolios();
+			for (unsigned i = 0; i < portfolios.size(); ++i)
+			{
+				const Portfolio& portfolio = portfolios[i];
+				if (i > 0) json += ',';
+				json += "{\"label\":" + quote(portfolio.label()) + ",\"assets\":[";
+
+				const std::vector<Asset>& assets = portfolio.assets();
+				for (unsigned j = 0; j < assets.size(); ++j)
+				{
+					if (j > 0) json += ',';
+					json += "{\"ticker\":" + quote(assets[j].ticker()) + ",\"interval\":"
+						+ std::to_string(assets[j].interval()) + "}";
+				}
+				json += "]}";
+			}
+			json += "]}";
+
+			res.set_content(json, JSON_FORMAT);
 		}
 
 		void get_accinfo(const httplib::Request& req,  httplib::Response& res)
 		{
 			DEBUG("Server: GET @ %s", req.path);
 
-			// int asset_type;
-			// AccountInfo accinfo;
-			// json response;
+			Portfolio *portfolio = trade_system->get_portfolio(req.get_param_value("portfolio"));
+			if (!portfolio)
+			{
+				res.status = 404;
+				res.set_content("portfolio does not exist", TEXT_FORMAT);
+				return;
+			}
+
+			Result<Account> acc = portfolio->get_client().get_account();
+			if (!acc)
+			{
+				res.status = 502;
+				res.set_content(acc.error(), TEXT_FORMAT);
+				return;
+			}
+
+			const Account& info = acc.get();
+			char buf[200];
+			snprintf(buf, sizeof(buf), "{\"balance\":%f,\"buying_power\":%f,\"equity\":%f}",
+				info.balance(), info.buying_power(), info.equity());
+			res.set_content(buf, JSON_FORMAT);
+		}
+
+		/**
+		 * Finds the portfolio and asset a request names with the portfolio
+		 * parameter and the given index parameter. Responds with an error if
+		 * either doesn't exist.
+		 *
+		 * @return	the portfolio or nullptr
+		 */
+		static Portfolio *request_asset(const httplib::Request& req, httplib::Response& res,
+			const char *param, unsigned& index)
+		{
+			Portfolio *portfolio = trade_system->get_portfolio(req.get_param_value("portfolio"));
+			if (!portfolio)
+			{
+				res.status = 404;
+				res.set_content("portfolio does not exist", TEXT_FORMAT);
+				return nullptr;
+			}
 
-			// asset_type = std::stoi(req.get_param_value("asset_type"));
+			std::string value = req.get_param_value(param);
+			char *end = nullptr;
+			unsigned long parsed = strtoul(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0' || parsed >= portfolio->assets().size())
+			{
+				res.status = 404;
+				res.set_content("asset does not exist", TEXT_FORMAT);
+				return nullptr;
+			}
 
-			// const Client* client;// = get_client(asset_type);
-			// accinfo = client->get_account_info();
-			// response["balance"] = accinfo.balance();
-			// response["buying_power"] = accinfo.buying_power();
-			// response["equity"] = accinfo.equity();
+			index = (unsigned)parsed;
+			return portfolio;
+		}
 
-			// res.set_content(response.dump(), JSON_FORMAT);
+		// appends a json array of the values
+		template <typename F>
+		static void write_array(std::string& json, const char *key, unsigned count, F value)
+		{
+			char buf[32];
+			json += ",\"";
+			json += key;
+			json += "\":[";
+			for (unsigned i = 0; i < count; ++i)
+			{
+				snprintf(buf, sizeof(buf), i ? ",%g" : "%g", value(i));
+				json += buf;
+			}
+			json += ']';
 		}
 
 		void get_watch(const httplib::Request& req,  httplib::Response& res)
 		{
-			DEBUG("Server: GET @ %s", req.path);
+			DEBUG("Server GET @ %s", req.path);
 
-			// int index = std::stoi(req.get_param_value("index"));
-			// const Asset* asset;// = get_asset(index);
-			// const StrategyData& data = asset->data();
-			// const Client* client;// = asset->client();
-			// AssetInfo info = client->get_asset_info(asset->ticker());
-
-			// json response;
-			// json& jacc = response["asset"];
-			// jacc["risk"] = asset->risk();
-			// jacc["shares"] = info.shares();
-			// jacc["live"] = asset->is_live();
-			// jacc["paper"] = false;
-
-			// response["interval"] = data.candles().interval();
-			// response["ticker"] = asset->ticker();
-
-			// const CandleSet& c = data.candles();
-			// int len = asset->data_length();
-			// int ci = c.size() - len;
-			// for (unsigned i = 0; i < len; i++)
-			// {
-			// 	response["x"][i] = i;
-			// 	response["open"][i] = c[ci].open();
-			// 	response["high"][i] = c[ci].high();
-			// 	response["low"][i] = c[ci].low();
-			// 	response["close"][i] = c[ci].close();
-			// 	response["volume"][i] = c[ci].volume();
-			// 	ci++;
-			// }
-
-			// //unsigned indi_index = 0;
-	
-			// for (int i = 0; i < data.size(); i++)
-			// {
-			// 	json& indi = response["indicators"][i];
-			// 	indi["type"] = data[i].type();
-			// 	indi["label"] = data[i].label();
-			// 	const Indicator& indicator = data[i];
-			// 	for (int j = 0; j < indicator.size(); j++)
-			// 	{
-			// 		indi["data"][j] = indicator.front(j);
-			// 	}
-			// }
-			// res.set_content(response.dump(), JSON_FORMAT);
-		}
+			unsigned index;
+			Portfolio *portfolio = request_asset(req, res, "index", index);
+			if (!portfolio) return;
+
+			const Asset& asset = portfolio->assets()[index];
+			Result<Position> pos = portfolio->get_client().get_position(asset.ticker());
+			bool live = portfolio->is_live();
+
+			char buf[160];
+			snprintf(buf, sizeof(buf), "\"asset\":{\"risk\":%f,\"shares\":%f,\"live\":%s,"
+				"\"paper\":false}", asset.risk(), pos ? pos.get().shares() : 0.0,
+				live ? "true" : "false");
+			std::string json = "{\"ticker\":" + quote(asset.ticker()) + ",\"interval\":"
+				+ std::to_string(asset.interval()) + "," + buf;
 
-		/*
-			TODO:
-			Add customizability to the backtest calls
-		*/
+			// the interface shows the asset as not live when there is no chart
+			if (!live)
+			{
+				res.set_content(json + "}", JSON_FORMAT);
+				return;
+			}
+
+			Result<PriceHistory> res_hist = portfolio->fetch_asset(index);
+			if (!res_hist)
+			{
+				res.status = 502;
+				res.set_content(res_hist.error(), TEXT_FORMAT);
+				return;
+			}
+
+			const PriceHistory& hist = res_hist.get();
+			Chart chart;
+			try
+			{
+				chart = asset.strategy().execute(hist, asset.ranges());
+			}
+			catch (const std::string& error)
+			{
+				res.status = 500;
+				res.set_content(error, TEXT_FORMAT);
+				return;
+			}
+
+			// the indicators only cover the last candles of the history
+			unsigned length = std::min((unsigned)hist.size(), asset.data_length());
+			unsigned first = hist.size() - length;
+			write_array(json, "x", length, [](unsigned i) { return (double)i; });
+			write_array(json, "open", length, [&](unsigned i) { return hist.get(first + i).open(); });
+			write_array(json, "high", length, [&](unsigned i) { return hist.get(first + i).high(); });
+			write_array(json, "low", length, [&](unsigned i) { return hist.get(first + i).low(); });
+			write_array(json, "close", length, [&](unsigned i) { return hist.get(first + i).close(); });
+			write_array(json, "volume", length, [&](unsigned i) { return hist.get(first + i).volume(); });
+
+			json += ",\"indicators\":[";
+			for (short i = 0; i < chart.size(); ++i)
+			{
+				const Indicator& indicator = chart[i];
+				if (i > 0) json += ',';
+				json += "{\"type\":" + quote(indicator.type() ? indicator.type() : "")
+					+ ",\"label\":" + quote(indicator.label() ? indicator.label() : "");
+				write_array(json, "data", std::min(indicator.size(), length),
+					[&](unsigned j) { return indicator.front(j); });
+				json += '}';
+			}
+			json += "]}";
+
+			res.set_content(json, JSON_FORMAT);
+		}
 
 		void get_backtest(const httplib::Request& req,  httplib::Response& res)
 		{
 			DEBUG("Server GET @ %s", req.path);
-			
-			// int asset_index, strat_index;
-			// json response;
-			// strat_index = std::stoi(req.get_param_value("strategy"));
-			// asset_index = std::stoi(req.get_param_value("asset"));
-			// std::string sranges = req.get_param_value("ranges");
-			// std::vector<PaperAccount> results;
-			
-			// if (sranges.empty())
-			// {
-			// 	results = interface::backtest(strat_index, asset_index, 500.0, false, 5, 155, 10, {});
-			// }
-			// else
-			// {	
-			// 	std::cout << "ranges were gotten!\n";
-			// 	std::vector<int> ranges;
-			// 	std::string tmp;
-
-			// 	for (int i = 0; i < sranges.size(); i++)
-			// 	{
-			// 		if (sranges[i] == ',' || sranges[i] == ' ')
-			// 		{
-			// 			if (!tmp.empty())
-			// 			{
-			// 				ranges.push_back(std::stoi(tmp));
-			// 				tmp.clear();
-			// 			}
-			// 			continue;
-			// 		}
-			// 		tmp += sranges[i];
-			// 	}
-
-			// 	if (!tmp.empty())
-			// 	{
-			// 		ranges.push_back(std::stoi(tmp));
-			// 	}
-
-			// 	std::cout << "Ranges: " << ranges.size() << std::endl;
-			// 	results = interface::backtest(strat_index, asset_index, 500, false, 5, 155, 10, ranges);
-			// }
-			// std::cout << "Got result!\n";
-
-			// for (int i = 0; i < results.size(); i++)
-			// {
-			// 	json& curr = response[i];
-
-			// 	curr["buys"] = results[i].long_entrances();
-			// 	curr["sells"] = results[i].long_exits();
-			// 	curr["interval"] = results[i].interval();
-
-			// 	auto ranges = results[i].ranges();
-			// 	for (int j = 0; j < ranges.size(); j++)
-			// 	{
-			// 		curr["ranges"][j] = ranges[j];
-			// 	}
-
-			// 	/*
-			// 		TODO :
-			// 			Redo all of these assignments to fit with current system
-			// 	*/
-
-			// 	curr["elapsedhrs"] = results[i].elapsed_hours();
-			// 	curr["initial"] = results[i].principal();
-			// 	curr["shares"] = results[i].shares();
-			// 	curr["balance"] = results[i].balance();
-			// 	curr["equity"] = results[i].equity();
-			// 	curr["netreturn"] = results[i].net_return();
-			// 	curr["preturn"] = results[i].pct_return();
-			// 	curr["hrreturn"] = results[i].net_per_year();
-			// 	curr["phrreturn"] = results[i].pct_per_year();
-			// 	curr["winrate"] = results[i].long_win_rate();
-			// 	curr["bwinrate"] = results[i].long_win_rate();
-			// 	curr["swinrate"] = results[i].long_win_rate();
-			// }
-
-			// res.set_content(response.dump(), JSON_FORMAT);
+
+			unsigned index;
+			Portfolio *portfolio = request_asset(req, res, "asset", index);
+			if (!portfolio) return;
+			const Asset& asset = portfolio->assets()[index];
+
+			// ranges are separated by commas or spaces, none means the asset's own
+			std::vector<int> ranges;
+			std::string param = req.get_param_value("ranges");
+			for (const char *pos = param.c_str(); *pos;)
+			{
+				char *end;
+				long range = strtol(pos, &end, 10);
+				if (end == pos)
+				{
+					pos += 1;
+					continue;
+				}
+				ranges.push_back((int)range);
+				pos = end;
+			}
+
+			if (!ranges.empty())
+			{
+				bool valid = ranges.size() == asset.ranges().size();
+				for (size_t i = 0; valid && i < ranges.size(); ++i)
+				{
+					valid = ranges[i] > 0 && ranges[i] <= asset.ranges()[i];
+				}
+
+				if (!valid)
+				{
+					res.status = 400;
+					res.set_content("ranges must be positive and no larger than the asset's",
+						TEXT_FORMAT);
+					return;
+				}
+			}
+
+			Result<PriceHistory> res_hist = portfolio->get_client().get_price_history(asset.ticker(),
+				asset.interval(), 0);
+			if (!res_hist)
+			{
+				res.status = 502;
+				res.set_content(res_hist.error(), TEXT_FORMAT);
+				return;
+			}
+
+			const PriceHistory& hist = res_hist.get();
+			if (hist.size() <= asset.candle_count())
+			{
+				res.status = 502;
+				res.set_content("not enough candles to backtest", TEXT_FORMAT);
+				return;
+			}
+
+			PaperAccount acc(BACKTEST_PRINCIPAL, 1, 0.0, 1.0, hist.front().open(), false,
+				asset.interval(), ranges.empty() ? asset.ranges() : ranges);
+			if (!backtest_permutation(acc, asset, hist, &asset.strategy(), ranges))
+			{
+				res.status = 500;
+				res.set_content("strategy failed during the backtest", TEXT_FORMAT);
+				return;
+			}
+
+			std::string json = "[{\"ranges\":[";
+			for (size_t i = 0; i < acc.ranges().size(); ++i)
+			{
+				if (i > 0) json += ',';
+				json += std::to_string(acc.ranges()[i]);
+			}
+
+			char buf[640];
+			snprintf(buf, sizeof(buf), "],\"buys\":%d,\"sells\":%d,\"interval\":%d,"
+				"\"elapsedhrs\":%f,\"initial\":%f,\"shares\":%f,\"balance\":%f,\"equity\":%f,"
+				"\"netreturn\":%f,\"preturn\":%f,\"hrreturn\":%f,\"phrreturn\":%f,"
+				"\"winrate\":%f,\"bwinrate\":%f,\"swinrate\":%f}]",
+				acc.long_entrances(), acc.long_exits(), acc.interval(), acc.elapsed_hours(),
+				acc.principal(), acc.shares(), acc.balance(), acc.equity(), acc.net_return(),
+				acc.pct_return(), acc.net_per_year(), acc.pct_per_year(), acc.win_rate(),
+				acc.long_win_rate(), acc.short_win_rate());
+			json += buf;
+
+			res.set_content(json, JSON_FORMAT);
+		}
+
+		static void write_header(std::string& out, const char *name, const char *type,
+			const char *help)
+		{
+			out += "# HELP ";
+			out += name;
+			out += ' ';
+			out += help;
+			out += "\n# TYPE ";
+			out += name;
+			out += ' ';
+			out += type;
+			out += '\n';
+		}
+
+		static void write_sample(std::string& out, const char *name, const std::string& labels,
+			double value)
+		{
+			char buf[40];
+			snprintf(buf, sizeof(buf), " %.10g\n", value);
+			out += name;
+			if (!labels.empty()) out += "{" + labels + "}";
+			out += buf;
+		}
+
+		static void write_sample(std::string& out, const char *name, const std::string& labels,
+			uint64_t value)
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), " %llu\n", (unsigned long long)value);
+			out += name;
+			if (!labels.empty()) out += "{" + labels + "}";
+			out += buf;
+		}
+
+		// summary of durations counted in nanoseconds without quantiles
+		static void write_duration(std::string& out, const char *name, const std::string& labels,
+			uint64_t count, uint64_t nanos)
+		{
+			write_sample(out, (std::string(name) + "_sum").c_str(), labels, nanos / 1e9);
+			write_sample(out, (std::string(name) + "_count").c_str(), labels, count);
+		}
+
+		static void write_counters(std::string& out)
+		{
+			uint64_t totals[METRIC_COUNT];
+			collect_metrics(totals);
+
+			write_header(out, "daytrender_client_requests_total", "counter",
+				"Requests made through client plugins.");
+			for (unsigned i = 0; i < CLIENT_FUNCTION_COUNT; ++i)
+			{
+				write_sample(out, "daytrender_client_requests_total",
+					"function=\"" + std::string(client_function_name(i)) + "\"",
+					totals[METRIC_CLIENT_REQUESTS + i]);
+			}
+
+			write_header(out, "daytrender_client_request_errors_total", "counter",
+				"Requests that client plugins returned an error for.");
+			for (unsigned i = 0; i < CLIENT_FUNCTION_COUNT; ++i)
+			{
+				write_sample(out, "daytrender_client_request_errors_total",
+					"function=\"" + std::string(client_function_name(i)) + "\"",
+					totals[METRIC_CLIENT_ERRORS + i]);
+			}
+
+			write_header(out, "daytrender_client_request_seconds", "summary",
+				"Time spent in client plugin requests.");
+			for (unsigned i = 0; i < CLIENT_FUNCTION_COUNT; ++i)
+			{
+				write_duration(out, "daytrender_client_request_seconds",
+					"function=\"" + std::string(client_function_name(i)) + "\"",
+					totals[METRIC_CLIENT_REQUESTS + i], totals[METRIC_CLIENT_NANOS + i]);
+			}
+
+			write_header(out, "daytrender_strategy_execution_seconds", "summary",
+				"Time spent executing strategies.");
+			write_duration(out, "daytrender_strategy_execution_seconds", "",
+				totals[METRIC_STRATEGY_EXECUTIONS], totals[METRIC_STRATEGY_NANOS]);
+
+			write_header(out, "daytrender_candles_fetched_total", "counter",
+				"Candles received from client plugins.");
+			write_sample(out, "daytrender_candles_fetched_total", "", totals[METRIC_CANDLES_FETCHED]);
+
+			write_header(out, "daytrender_orders_placed_total", "counter",
+				"Orders accepted by the broker.");
+			write_sample(out, "daytrender_orders_placed_total", "", totals[METRIC_ORDERS_PLACED]);
+
+			write_header(out, "daytrender_orders_rejected_total", "counter",
+				"Orders rejected by the broker or stopped by the pre-trade check.");
+			write_sample(out, "daytrender_orders_rejected_total", "reason=\"broker\"",
+				totals[METRIC_ORDERS_REJECTED]);
+			write_sample(out, "daytrender_orders_rejected_total", "reason=\"pretrade\"",
+				totals[METRIC_ORDERS_BLOCKED]);
+
+			write_header(out, "daytrender_scheduler_lag_seconds", "summary",
+				"How late scheduled events were dispatched.");
+			write_duration(out, "daytrender_scheduler_lag_seconds", "",
+				totals[METRIC_SCHEDULER_EVENTS], totals[METRIC_SCHEDULER_LAG_NANOS]);
+
+			write_header(out, "daytrender_rate_limit_wait_seconds", "summary",
+				"Time requests waited for the rate limit of their client.");
+			write_duration(out, "daytrender_rate_limit_wait_seconds", "",
+				totals[METRIC_RATE_LIMIT_ADMITTED], totals[METRIC_RATE_LIMIT_NANOS]);
+
+			// only counted while allocation accounting is on
+			if (!is_accounting_allocations()) return;
+
+			write_header(out, "daytrender_allocations_total", "counter",
+				"Heap allocations made by each subsystem.");
+			for (unsigned i = 0; i < ALLOC_SUBSYSTEM_COUNT; ++i)
+			{
+				write_sample(out, "daytrender_allocations_total",
+					"subsystem=\"" + std::string(alloc_subsystem_name(i)) + "\"",
+					totals[METRIC_ALLOCATIONS + i]);
+			}
+
+			write_header(out, "daytrender_allocated_bytes_total", "counter",
+				"Bytes allocated on the heap by each subsystem.");
+			for (unsigned i = 0; i < ALLOC_SUBSYSTEM_COUNT; ++i)
+			{
+				write_sample(out, "daytrender_allocated_bytes_total",
+					"subsystem=\"" + std::string(alloc_subsystem_name(i)) + "\"",
+					totals[METRIC_ALLOCATED_BYTES + i]);
+			}
+
+			write_header(out, "daytrender_steady_state_allocations_total", "counter",
+				"Heap allocations made during a tick after warmup.");
+			write_sample(out, "daytrender_steady_state_allocations_total", "",
+				totals[METRIC_STEADY_STATE_ALLOCATIONS]);
+		}
+
+		static void write_portfolios(std::string& out)
+		{
+			static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+			const std::vector<Portfolio>& portfolios = trade_system->get_portfolios();
+
+			write_header(out, "daytrender_stage_latency_seconds", "summary",
+				"Latency of each stage between a candle closing and its order returning.");
+			for (const Portfolio& portfolio : portfolios)
+			{
+				for (unsigned stage = 0; stage < STAGE_COUNT; ++stage)
+				{
+					LatencyHistogram merged = portfolio.latency().merged(stage);
+					std::string labels = "portfolio=" + quote(portfolio.label())
+						+ ",stage=\"" + stage_name(stage) + "\"";
+
+					for (double quantile : quantiles)
+					{
+						char buf[32];
+						snprintf(buf, sizeof(buf), ",quantile=\"%g\"", quantile);
+						write_sample(out, "daytrender_stage_latency_seconds", labels + buf,
+							merged.percentile(quantile) / 1e9);
+					}
+					write_duration(out, "daytrender_stage_latency_seconds", labels,
+						merged.count(), merged.sum());
+				}
+			}
+
+			const char *gauges[][2] =
+			{
+				{ "daytrender_portfolio_equity", "Equity of the account at the last update." },
+				{ "daytrender_portfolio_pl", "Change in equity over the history window." },
+				{ "daytrender_portfolio_drawdown", "Equity below the peak of the history window." }
+			};
+
+			for (unsigned i = 0; i < 3; ++i)
+			{
+				write_header(out, gauges[i][0], "gauge", gauges[i][1]);
+				for (const Portfolio& portfolio : portfolios)
+				{
+					const PortfolioGauges& values = portfolio.gauges();
+					const std::atomic<double>& value = i == 0 ? values.equity
+						: i == 1 ? values.pl : values.drawdown;
+					write_sample(out, gauges[i][0], "portfolio=" + quote(portfolio.label()),
+						value.load(std::memory_order_relaxed));
+				}
+			}
+		}
+
+		static void write_queues(std::string& out)
+		{
+			std::vector<QueueMetrics> queues = trade_system->queue_metrics();
+
+			write_header(out, "daytrender_queue_depth", "gauge",
+				"Items waiting between pipeline stages.");
+			for (const QueueMetrics& queue : queues)
+			{
+				write_sample(out, "daytrender_queue_depth", "portfolio=" + quote(queue.portfolio)
+					+ ",queue=\"" + queue.queue + "\"", (uint64_t)queue.depth);
+			}
+
+			write_header(out, "daytrender_queue_capacity", "gauge",
+				"Items that fit between pipeline stages.");
+			for (const QueueMetrics& queue : queues)
+			{
+				write_sample(out, "daytrender_queue_capacity", "portfolio=" + quote(queue.portfolio)
+					+ ",queue=\"" + queue.queue + "\"", (uint64_t)queue.capacity);
+			}
+
+			write_header(out, "daytrender_queue_high_water", "gauge",
+				"Largest depth seen between pipeline stages.");
+			for (const QueueMetrics& queue : queues)
+			{
+				write_sample(out, "daytrender_queue_high_water", "portfolio=" + quote(queue.portfolio)
+					+ ",queue=\"" + queue.queue + "\"", (uint64_t)queue.high_water);
+			}
+
+			write_header(out, "daytrender_queue_pushed_total", "counter",
+				"Items passed between pipeline stages.");
+			for (const QueueMetrics& queue : queues)
+			{
+				write_sample(out, "daytrender_queue_pushed_total", "portfolio=" + quote(queue.portfolio)
+					+ ",queue=\"" + queue.queue + "\"", (uint64_t)queue.pushed);
+			}
+
+			write_header(out, "daytrender_queue_rejected_total", "counter",
+				"Pushes that found the queue between pipeline stages full.");
+			for (const QueueMetrics& queue : queues)
+			{
+				write_sample(out, "daytrender_queue_rejected_total", "portfolio=" + quote(queue.portfolio)
+					+ ",queue=\"" + queue.queue + "\"", (uint64_t)queue.rejected);
+			}
+		}
+
+		static void write_allocator(std::string& out)
+		{
+			AllocatorStats stats = allocator_stats();
+			if (!stats.ok) return;
+
+			write_header(out, "daytrender_allocator_arena_bytes", "gauge",
+				"Heap memory obtained from the system.");
+			write_sample(out, "daytrender_allocator_arena_bytes", "", stats.arena);
+			write_header(out, "daytrender_allocator_mapped_bytes", "gauge",
+				"Memory mapped separately for large allocations.");
+			write_sample(out, "daytrender_allocator_mapped_bytes", "", stats.mapped);
+			write_header(out, "daytrender_allocator_in_use_bytes", "gauge",
+				"Memory currently allocated.");
+			write_sample(out, "daytrender_allocator_in_use_bytes", "", stats.in_use);
+			write_header(out, "daytrender_allocator_free_bytes", "gauge",
+				"Heap memory held by the allocator but not in use.");
+			write_sample(out, "daytrender_allocator_free_bytes", "", stats.free);
+		}
+
+		void get_metrics(const httplib::Request& req,  httplib::Response& res)
+		{
+			DEBUG("Server GET @ %s", req.path);
+
+			// everything is read from counters the trade loop already keeps, so a
+			// scrape never blocks it
+			std::string out;
+			write_counters(out);
+			write_portfolios(out);
+			write_queues(out);
+			write_allocator(out);
+
+			res.set_content(out, METRICS_FORMAT);
+		}
+
+		void get_trace(const httplib::Request& req,  httplib::Response& res)
+		{
+			DEBUG("Server GET @ %s", req.path);
+			res.set_content(trace_json(), JSON_FORMAT);
 		}
 
 		void get_shutdown(const httplib::Request& req,  httplib::Response& res)
 		{
 			DEBUG("Server GET @ %s", req.path);
 			res.set_content("Shutting down...", TEXT_FORMAT);
-			daytrender::stop();
+			trade_system->stop();
 		}
 	}
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 // local includes
 #include <data/tradesystem.h>
+#include <util/asynclog.h>
+#include <util/trace.h>
 
 // standard library
 #include <cstring>
@@ -149,6 +151,19 @@ void interrupt(int signal)
 	system_ref->stop();
 }
 
+// SIGUSR1 writes a trace of recent spans and SIGUSR2 turns tracing on or off
+void trace_signal(int signal)
+{
+	if (signal == SIGUSR1)
+	{
+		request_trace();
+	}
+	else
+	{
+		set_tracing(!is_tracing());
+	}
+}
+
 int main(int argc, const char *argv[])
 {
 	bool command_line = argc > 1;
@@ -176,10 +191,17 @@ int main(int argc, const char *argv[])
 
 	// setting up handler for keyboard interrupts
 	std::signal(SIGINT, interrupt);
+	std::signal(SIGUSR1, trace_signal);
+	std::signal(SIGUSR2, trace_signal);
+
+	// hot paths log through a background thread while trading
+	start_async_log();
 
 	// returns when program has ended
 	system.start();
 
+	stop_async_log();
+
 	SUCCESS("DayTrender has stopped");
 	return 0;
 }
\ No newline at end of file
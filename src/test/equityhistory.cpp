@@ -0,0 +1,80 @@
+// local includes
+#include <data/equityhistory.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace daytrender;
+
+#define WINDOW 100
+#define CAPACITY 16
+
+int main(void)
+{
+	EquityHistory hist(CAPACITY, WINDOW);
+	assert(hist.empty());
+
+	hist.push(0, 100.0);
+	hist.push(10, 120.0);
+	hist.push(20, 90.0);
+	assert(hist.size() == 3);
+	assert(hist.peak() == 120.0);
+	assert(hist.trough() == 90.0);
+	assert(hist.pl() == -10.0);
+	assert(hist.drawdown() == 30.0);
+
+	// samples older than the window are dropped relative to the newest
+	hist.push(115, 95.0);
+	assert(hist.front().time == 20);
+	assert(hist.peak() == 95.0);
+	assert(hist.trough() == 90.0);
+
+	// comparing against a brute force window with random samples
+	std::mt19937 rng(7);
+	std::vector<EquitySample> samples;
+	hist.clear();
+
+	long long time = 0;
+	for (unsigned i = 0; i < 10000; ++i)
+	{
+		time += rng() % 15;
+		double equity = (double)(rng() % 1000);
+		hist.push(time, equity);
+
+		samples.push_back({ time, equity });
+		while (time - samples.front().time > WINDOW) samples.erase(samples.begin());
+
+		assert(hist.size() == samples.size());
+		double peak = samples.front().equity, trough = peak;
+		for (const EquitySample& s : samples)
+		{
+			peak = std::max(peak, s.equity);
+			trough = std::min(trough, s.equity);
+		}
+		assert(hist.peak() == peak);
+		assert(hist.trough() == trough);
+		assert(hist.pl() == equity - samples.front().equity);
+
+		// segments hold the same samples in order
+		EquitySegments segments = hist.segments();
+		assert(segments.size() == samples.size());
+		for (size_t j = 0; j < samples.size(); ++j)
+		{
+			const EquitySample& s = j < segments.first_size
+				? segments.first[j]
+				: segments.second[j - segments.first_size];
+			assert(s.time == samples[j].time && s.equity == samples[j].equity);
+		}
+	}
+
+	// more samples arrived within the window than it started with room for
+	assert(hist.capacity() > CAPACITY);
+
+	puts("Equity history passed all tests");
+	return 0;
+}
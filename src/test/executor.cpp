@@ -0,0 +1,49 @@
+// local includes
+#include <util/executor.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <future>
+#include <mutex>
+#include <vector>
+
+using namespace daytrender;
+
+int main(void)
+{
+	Executor executor(1, 3);
+	std::mutex mtx;
+	std::vector<int> order;
+
+	// holding the only thread so everything after it queues up
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::future<void> blocker = executor.submit(0, [released]() { released.wait(); });
+
+	std::vector<std::future<int>> results;
+	int priorities[] = { 2, 2, 1, 0, 7, 1 };
+	for (int i = 0; i < 6; ++i)
+	{
+		results.push_back(executor.submit(priorities[i], [&, i]()
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			order.push_back(i);
+			return i * 10;
+		}));
+	}
+
+	release.set_value();
+	blocker.get();
+	for (int i = 0; i < 6; ++i) assert(results[i].get() == i * 10);
+
+	// higher priorities first, submission order within one, and priorities
+	// past the last count as the last
+	std::vector<int> expected = { 3, 2, 5, 0, 1, 4 };
+	assert(order == expected);
+
+	puts("executor test passed");
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+// local includes
+#include <util/jsonreader.h>
+#include <util/oandacandles.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <string>
+
+using namespace daytrender;
+
+int main(void)
+{
+	std::string body = "{\"instrument\":\"EUR_USD\",\"granularity\":\"M5\",\"candles\":["
+		"{\"complete\":true,\"volume\":52,\"time\":\"2021-01-01T00:00:00Z\","
+		"\"mid\":{\"o\":\"1.22134\",\"h\":\"1.22200\",\"l\":\"1.22001\",\"c\":\"1.22150\"}},"
+		"{\"complete\":false,\"volume\":7,\"tags\":[{\"a\":[1,2]},\"x\\\"]\"],"
+		"\"mid\":{\"o\":\"1.22150\",\"h\":\"1.3\",\"l\":\"1.2\",\"c\":\"-2.5e-1\"}}]}";
+
+	JsonReader json(body);
+
+	// finding a key skips the values before it
+	assert(json.next() == JSON_OBJECT);
+	assert(json.find("candles"));
+	assert(json.next() == JSON_ARRAY);
+
+	// first candle
+	assert(json.next() == JSON_OBJECT);
+	assert(json.find("volume"));
+	assert(json.next() == JSON_NUMBER);
+	assert(json.to_int() == 52);
+	assert(json.find("mid"));
+	assert(json.next() == JSON_OBJECT);
+	assert(json.next() == JSON_KEY && json.equals("o"));
+	assert(json.next() == JSON_STRING && json.to_double() == 1.22134);
+	assert(json.next() == JSON_KEY && json.equals("h"));
+	assert(json.skip());
+	assert(json.find("c"));
+	assert(json.next() == JSON_STRING && json.to_double() == 1.22150);
+	assert(json.next() == JSON_OBJECT_END);
+	assert(json.next() == JSON_OBJECT_END);
+
+	// second candle has nested containers and escaped quotes to skip
+	assert(json.next() == JSON_OBJECT);
+	assert(json.next() == JSON_KEY && json.equals("complete"));
+	assert(json.next() == JSON_FALSE);
+	assert(json.find("mid"));
+	assert(json.next() == JSON_OBJECT);
+	assert(json.find("c"));
+	assert(json.next() == JSON_STRING && json.to_double() == -0.25);
+	assert(json.next() == JSON_OBJECT_END);
+	assert(!json.find("missing"));
+	assert(json.next() == JSON_ARRAY_END);
+	assert(json.next() == JSON_OBJECT_END);
+	assert(json.depth() == 0);
+	assert(json.next() == JSON_END);
+
+	// truncated input is reported rather than read past
+	JsonReader truncated("{\"candles\":[{\"mid\":\"1.0");
+	assert(truncated.next() == JSON_OBJECT);
+	assert(truncated.find("candles"));
+	assert(!truncated.skip());
+
+	// the client's decoder fills exactly the candles requested
+	PriceHistory hist(2, 300);
+	assert(!decode_oanda_candles(body, hist));
+	assert(hist.get(0).open() == 1.22134 && hist.get(0).volume() == 52.0);
+	assert(hist.get(1).close() == -0.25 && hist.get(1).high() == 1.3);
+
+	PriceHistory short_hist(1, 300);
+	assert(decode_oanda_candles(body, short_hist));
+	PriceHistory long_hist(3, 300);
+	assert(decode_oanda_candles(body, long_hist));
+	assert(decode_oanda_candles("{\"candles\":[{\"mid\":\"1.0", hist));
+
+	puts("JsonReader passed all tests");
+	return 0;
+}
@@ -0,0 +1,61 @@
+// local includes
+#include <util/latency.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+using namespace daytrender;
+
+int main(void)
+{
+	// every bucket's bound maps back to the bucket
+	for (unsigned i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+	{
+		assert(LatencyHistogram::index_of(LatencyHistogram::value_of(i)) == i);
+	}
+
+	// values are never under reported by more than the precision
+	for (uint64_t value = 1; value < (1ULL << LATENCY_MAX_BITS); value = value * 3 / 2 + 1)
+	{
+		uint64_t bound = LatencyHistogram::value_of(LatencyHistogram::index_of(value));
+		assert(bound >= value);
+		assert(bound - value <= value / LatencyHistogram::SUB_BUCKETS);
+	}
+
+	LatencyHistogram hist;
+	assert(hist.count() == 0);
+	assert(hist.percentile(0.5) == 0);
+
+	for (uint64_t i = 1; i <= 1000; ++i) hist.record(i * 1000);
+	assert(hist.count() == 1000);
+	assert(hist.max() == 1000000);
+	assert(hist.mean() == 500500.0);
+
+	uint64_t p50 = hist.percentile(0.5);
+	assert(p50 >= 500000 && p50 <= 500000 + 500000 / LatencyHistogram::SUB_BUCKETS);
+	assert(hist.percentile(1.0) == 1000000);
+
+	// negative durations from clock adjustments count as 0
+	hist.record(-5LL);
+	assert(hist.count() == 1001);
+
+	LatencyTracker tracker(3);
+	tracker.record(0, STAGE_FETCH, 100);
+	tracker.record(2, STAGE_FETCH, 300);
+	tracker.record(1, STAGE_ORDER, 200);
+
+	LatencyHistogram merged = tracker.merged(STAGE_FETCH);
+	assert(merged.count() == 2);
+	assert(merged.max() == 300);
+	assert(tracker.merged(STAGE_ORDER).count() == 1);
+	assert(tracker.merged(STAGE_EVALUATE).count() == 0);
+
+	LatencyHistogram copy(merged);
+	assert(copy.count() == 2);
+	assert(copy.percentile(0.5) == merged.percentile(0.5));
+
+	puts("latency histogram test passed");
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+// local includes
+#include <data/marketgenerator.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace daytrender;
+
+#define SAMPLE_SIZE 200000
+
+static bool same_candles(const PriceHistory& a, const PriceHistory& b)
+{
+	if (a.size() != b.size()) return false;
+	for (unsigned i = 0; i < a.size(); ++i)
+	{
+		const Candle& x = a.get(i);
+		const Candle& y = b.get(i);
+		if (x.open() != y.open() || x.high() != y.high() || x.low() != y.low()
+			|| x.close() != y.close() || x.volume() != y.volume()) return false;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	assert(std::abs(normal_quantile(0.5)) < 1e-9);
+	assert(std::abs(normal_quantile(0.975) - 1.959963985) < 1e-8);
+	assert(std::abs(normal_quantile(0.001) + 3.090232306) < 1e-8);
+
+	MarketModel model;
+	assert(check_market_model(model) == nullptr);
+	model.garch_alpha = 0.2;
+	model.garch_beta = 0.8;
+	assert(check_market_model(model) != nullptr);
+
+	model.garch_alpha = 0.05;
+	model.garch_beta = 0.9;
+	model.regimes = { { 0.1, 0.15 }, { -0.3, 0.6 } };
+	model.regime_switch = 0.01;
+	model.gap_chance = 0.01;
+	model.gap_size = 0.02;
+	assert(check_market_model(model) == nullptr);
+
+	// the same seed gives the same candles, and another seed different ones
+	PriceHistory first = MarketGenerator(model, 1, 42).history(1500);
+	assert(same_candles(first, MarketGenerator(model, 1, 42).history(1500)));
+	assert(!same_candles(first, MarketGenerator(model, 1, 43).history(1500)));
+
+	for (unsigned i = 0; i < first.size(); ++i)
+	{
+		const Candle& candle = first.get(i);
+		assert(candle.low() > 0.0);
+		assert(candle.low() <= std::min(candle.open(), candle.close()));
+		assert(candle.high() >= std::max(candle.open(), candle.close()));
+	}
+
+	// returns have the volatility of the model
+	MarketModel plain;
+	plain.volatility = 0.5;
+	MarketGenerator single(plain);
+	PriceHistory walk = single.history(SAMPLE_SIZE);
+	assert(walk.get(SAMPLE_SIZE - 1).close() == single.last_close(0));
+
+	double sum = 0.0;
+	double squares = 0.0;
+	for (unsigned i = 0; i < walk.size(); ++i)
+	{
+		double r = std::log(walk.get(i).close() / walk.get(i).open());
+		sum += r;
+		squares += r * r;
+	}
+	double mean = sum / SAMPLE_SIZE;
+	double expected = plain.volatility * std::sqrt(plain.interval / (365.0 * 24.0 * 3600.0));
+	double deviation = std::sqrt(squares / SAMPLE_SIZE - mean * mean);
+	assert(std::abs(deviation / expected - 1.0) < 0.01);
+
+	// correlated assets move together
+	MarketGenerator pair(plain, 2, 7);
+	assert(pair.set_correlation(std::vector<double>{ 1.0, 2.0, 2.0, 1.0 }) != nullptr);
+	assert(pair.set_correlation(std::vector<double>{ 1.0, 0.8 }) != nullptr);
+	assert(pair.set_correlation(0.8) == nullptr);
+
+	std::vector<PriceHistory> basket = pair.basket(SAMPLE_SIZE);
+	assert(basket.size() == 2);
+
+	double xy = 0.0, xx = 0.0, yy = 0.0;
+	for (unsigned i = 0; i < SAMPLE_SIZE; ++i)
+	{
+		double x = std::log(basket[0].get(i).close() / basket[0].get(i).open());
+		double y = std::log(basket[1].get(i).close() / basket[1].get(i).open());
+		xy += x * y;
+		xx += x * x;
+		yy += y * y;
+	}
+	assert(std::abs(xy / std::sqrt(xx * yy) - 0.8) < 0.01);
+
+	puts("marketgenerator test passed");
+
+	return 0;
+}
@@ -0,0 +1,52 @@
+// local includes
+#include <util/metrics.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <thread>
+#include <vector>
+
+using namespace daytrender;
+
+int main(void)
+{
+	uint64_t totals[METRIC_COUNT];
+	collect_metrics(totals);
+	for (uint64_t total : totals) assert(total == 0);
+
+	count_metric(METRIC_CANDLES_FETCHED, 5);
+	count_request(CLIENT_ORDER, 1000, true);
+
+	// counts of threads that have exited are kept
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		threads.emplace_back([]()
+		{
+			for (unsigned j = 0; j < 10000; ++j) count_metric(METRIC_CANDLES_FETCHED);
+			count_request(CLIENT_ACCOUNT, -5, false);
+		});
+	}
+	for (std::thread& thread : threads) thread.join();
+
+	std::thread([]() { count_metric(METRIC_ORDERS_PLACED); }).join();
+
+	collect_metrics(totals);
+	assert(totals[METRIC_CANDLES_FETCHED] == 40005);
+	assert(totals[METRIC_CLIENT_REQUESTS + CLIENT_ORDER] == 1);
+	assert(totals[METRIC_CLIENT_ERRORS + CLIENT_ORDER] == 1);
+	assert(totals[METRIC_CLIENT_NANOS + CLIENT_ORDER] == 1000);
+	assert(totals[METRIC_CLIENT_REQUESTS + CLIENT_ACCOUNT] == 4);
+	assert(totals[METRIC_CLIENT_ERRORS + CLIENT_ACCOUNT] == 0);
+	// negative durations from clock adjustments count as zero
+	assert(totals[METRIC_CLIENT_NANOS + CLIENT_ACCOUNT] == 0);
+	assert(totals[METRIC_ORDERS_PLACED] == 1);
+
+	assert(client_function_name(CLIENT_PRICE_HISTORY) == std::string("get_price_history"));
+
+	puts("metrics test passed");
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+// local includes
+#include <data/pretradecheck.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+using namespace daytrender;
+
+#define SECOND 1000000LL
+
+int main(void)
+{
+	PreTradeLimits limits;
+	limits.max_rate = 2.0;
+	PreTradeCheck check(1, limits);
+
+	// bursts up to the rate, then one order per half second
+	long long now = SECOND;
+	for (int i = 0; i < 2; ++i)
+	{
+		assert(!check.check(0, 1.0, 10.0, 0.0, now));
+		check.record(0, i + 1.0, now);
+	}
+	assert(check.check(0, 1.0, 10.0, 0.0, now));
+	assert(!check.check(0, 1.0, 10.0, 0.0, now + SECOND / 2));
+
+	// a rate below one order per second allows single orders that far apart
+	limits.max_rate = 0.25;
+	check.set_limits(0, limits);
+	now = 10 * SECOND;
+	assert(!check.check(0, 1.0, 10.0, 0.0, now));
+	check.record(0, 1.0, now);
+	assert(check.check(0, 2.0, 10.0, 0.0, now + SECOND));
+	assert(check.check(0, 2.0, 10.0, 0.0, now + 3 * SECOND));
+	assert(!check.check(0, 2.0, 10.0, 0.0, now + 4 * SECOND));
+	check.record(0, 2.0, now + 4 * SECOND);
+
+	// a long pause doesn't save up more than one order
+	now += 60 * SECOND;
+	assert(!check.check(0, 3.0, 10.0, 0.0, now));
+	check.record(0, 3.0, now);
+	assert(check.check(0, 4.0, 10.0, 0.0, now));
+
+	puts("pretradecheck test passed");
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+// local includes
+#include <api/action.h>
+#include <data/rebalance.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+using namespace daytrender;
+
+int main(void)
+{
+	auto target = [](bool short_shares) { return short_shares ? -7.5 : 12.5; };
+
+	// entries are netted against what is held and rounded to the minimum
+	Position held(50.0, 0.0, 1.0, 10.0, 5.0);
+	Result<double> shares = rebalance_shares(ENTER_LONG, held, target);
+	assert(shares && shares.get() == 7.0);
+	shares = rebalance_shares(ENTER_SHORT, held, target);
+	assert(shares && shares.get() == -12.0);
+
+	// exits only close a position of their side
+	shares = rebalance_shares(EXIT_LONG, held, target);
+	assert(shares && shares.get() == -5.0);
+	shares = rebalance_shares(EXIT_SHORT, held, target);
+	assert(shares && shares.get() == 0.0);
+
+	// a held position with no known price isn't entered, let alone sold off
+	Position unpriced(50.0, 0.0, 1.0, 0.0, 5.0);
+	shares = rebalance_shares(ENTER_LONG, unpriced, [](bool) { return 0.0; });
+	assert(!shares);
+	shares = rebalance_shares(EXIT_LONG, unpriced, target);
+	assert(shares && shares.get() == -5.0);
+
+	puts("rebalance test passed");
+	return 0;
+}
@@ -0,0 +1,89 @@
+// local includes
+#include <util/ringbuffer.h>
+
+// standard library
+#include <assert.h>
+#include <stdio.h>
+
+#include <thread>
+#include <vector>
+
+using namespace daytrender;
+
+#define COUNT 100000
+#define PRODUCERS 4
+
+int main(void)
+{
+	// capacity is rounded up to a power of two and full buffers reject pushes
+	SpscRing<int> small(3);
+	assert(small.capacity() == 4);
+	for (int i = 0; i < 4; ++i) assert(small.push(int(i)));
+	assert(!small.push(4));
+	assert(small.rejected() == 1);
+	assert(small.high_water() == 4);
+
+	int value;
+	assert(small.pop(value) && value == 0);
+	assert(small.push(4));
+	for (int i = 1; i <= 4; ++i) assert(small.pop(value) && value == i);
+	assert(!small.pop(value));
+
+	// single producer values arrive in order
+	SpscRing<long> spsc(64);
+	std::thread producer([&]()
+	{
+		for (long i = 0; i < COUNT; ++i)
+		{
+			while (!spsc.push(long(i))) std::this_thread::yield();
+		}
+	});
+
+	for (long expected = 0; expected < COUNT;)
+	{
+		long out;
+		if (!spsc.pop(out))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		assert(out == expected);
+		expected += 1;
+	}
+	producer.join();
+
+	// every value from every producer arrives exactly once and in order per producer
+	MpscRing<long> mpsc(64);
+	std::vector<std::thread> producers;
+	for (long p = 0; p < PRODUCERS; ++p)
+	{
+		producers.emplace_back([&, p]()
+		{
+			for (long i = 0; i < COUNT; ++i)
+			{
+				while (!mpsc.push(p * COUNT + i)) std::this_thread::yield();
+			}
+		});
+	}
+
+	std::vector<long> next(PRODUCERS, 0);
+	for (long received = 0; received < COUNT * PRODUCERS;)
+	{
+		long out;
+		if (!mpsc.pop(out))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		long p = out / COUNT;
+		assert(out % COUNT == next[p]);
+		next[p] += 1;
+		received += 1;
+	}
+	for (std::thread& t : producers) t.join();
+	assert(mpsc.empty());
+	assert(mpsc.pushed() == COUNT * PRODUCERS);
+
+	puts("Ring buffers passed all tests");
+	return 0;
+}
@@ -0,0 +1,433 @@
+// local includes
+#include <api/strategy.h>
+#include <data/chart.h>
+#include <data/marketgenerator.h>
+#include <data/pricehistory.h>
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// external libraries
+#include <hirzel/logger.h>
+
+// range of every indicator if none are given
+#define DEFAULT_RANGE 20
+#define DEFAULT_ITERATIONS 10000
+#define WARMUP_ITERATIONS 100
+// distinct windows the calls are spread over
+#define WINDOW_COUNT 1024
+// times the ranges are doubled when measuring scaling
+#define SCALING_STEPS 4
+
+using namespace daytrender;
+
+// counts every allocation in the process, the strategy plugin's included
+static std::atomic<unsigned long long> allocations(0);
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+struct Options
+{
+	std::string strategy;
+	std::vector<int> ranges;
+	std::string candles;
+	unsigned iterations = DEFAULT_ITERATIONS;
+	unsigned seed = 1;
+	// nanoseconds per execute and allocations per execute, 0 if unlimited
+	double budget = 0.0;
+	double max_allocations = 0.0;
+	bool json = false;
+};
+
+struct IndicatorProfile
+{
+	const char *type;
+	const char *label;
+	double mean;
+};
+
+struct Profile
+{
+	unsigned window = 0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+	// per execute, including the chart the host makes for it
+	double allocations = 0.0;
+	double chart_allocations = 0.0;
+	std::vector<IndicatorProfile> indicators;
+};
+
+static void usage(const char *program)
+{
+	fprintf(stderr,
+		"usage: %s <strategy> [options]\n"
+		"\t--ranges <r1,r2,...>   ranges of the indicators (default %d each)\n"
+		"\t--candles <file>       csv of open,high,low,close,volume to use instead of a random walk\n"
+		"\t--iterations <count>   calls measured per window length (default %d)\n"
+		"\t--seed <seed>          seed of the random walk (default 1)\n"
+		"\t--budget <ns>          fail if a call takes longer on average\n"
+		"\t--max-allocs <count>   fail if a call allocates more on average\n"
+		"\t--json                 print the results as json\n",
+		program, DEFAULT_RANGE, DEFAULT_ITERATIONS);
+}
+
+static bool parse_options(Options& opts, int argc, char *argv[])
+{
+	if (argc < 2 || argv[1][0] == '-') return false;
+	opts.strategy = argv[1];
+
+	for (int i = 2; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (!strcmp(arg, "--json"))
+		{
+			opts.json = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) return false;
+		const char *value = argv[++i];
+
+		if (!strcmp(arg, "--ranges"))
+		{
+			std::stringstream ss(value);
+			std::string range;
+			while (std::getline(ss, range, ','))
+			{
+				int r = atoi(range.c_str());
+				if (r <= 0) return false;
+				opts.ranges.push_back(r);
+			}
+		}
+		else if (!strcmp(arg, "--candles"))
+		{
+			opts.candles = value;
+		}
+		else if (!strcmp(arg, "--iterations"))
+		{
+			opts.iterations = std::max(1, atoi(value));
+		}
+		else if (!strcmp(arg, "--seed"))
+		{
+			opts.seed = (unsigned)atoi(value);
+		}
+		else if (!strcmp(arg, "--budget"))
+		{
+			opts.budget = atof(value);
+		}
+		else if (!strcmp(arg, "--max-allocs"))
+		{
+			opts.max_allocations = atof(value);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Reads lines of open,high,low,close,volume. Lines that don't parse, such
+ * as a header, are skipped.
+ */
+static const char *read_candles(PriceHistory& out, const std::string& filepath)
+{
+	std::ifstream file(filepath);
+	if (!file) return "failed to open candles file";
+
+	std::vector<Candle> candles;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		double o, h, l, c, v;
+		if (sscanf(line.c_str(), "%lf,%lf,%lf,%lf,%lf", &o, &h, &l, &c, &v) != 5) continue;
+		candles.emplace_back(o, h, l, c, v);
+	}
+
+	if (candles.empty()) return "candles file did not contain any candles";
+
+	out = PriceHistory(candles.size(), 60);
+	for (unsigned i = 0; i < candles.size(); ++i) out.get(i) = candles[i];
+
+	return nullptr;
+}
+
+static double elapsed_nanos(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @return	an error message or an empty string on success
+ */
+static std::string profile(Profile& out, const Strategy& strategy, const PriceHistory& hist,
+	const std::vector<int>& ranges, unsigned iterations)
+{
+	out.window = *std::max_element(ranges.begin(), ranges.end()) + strategy.data_length();
+	if (hist.size() <= out.window) return "not enough candles for the window length";
+
+	unsigned windows = std::min(hist.size() - out.window, (unsigned)WINDOW_COUNT);
+	std::vector<PriceHistory> slices;
+	slices.reserve(windows);
+	for (unsigned i = 0; i < windows; ++i) slices.push_back(hist.slice(i, out.window));
+
+	try
+	{
+		for (unsigned i = 0; i < WARMUP_ITERATIONS; ++i)
+		{
+			strategy.execute(slices[i % windows], ranges);
+		}
+
+		// allocations made by the host for the chart are reported on their own
+		unsigned long long before = allocations.load();
+		{
+			Chart chart(ranges, slices[0], strategy.data_length());
+		}
+		out.chart_allocations = (double)(allocations.load() - before);
+
+		std::vector<double> times(iterations);
+		before = allocations.load();
+		for (unsigned i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			Chart chart = strategy.execute(slices[i % windows], ranges);
+			times[i] = elapsed_nanos(start);
+		}
+		out.allocations = (double)(allocations.load() - before) / (double)iterations;
+
+		double sum = 0.0;
+		for (double time : times) sum += time;
+		std::sort(times.begin(), times.end());
+		out.mean = sum / (double)iterations;
+		out.p50 = times[iterations / 2];
+		out.p99 = times[(iterations * 99) / 100];
+		out.max = times.back();
+	}
+	catch (const std::string& err)
+	{
+		return err;
+	}
+
+	if (!strategy.has_execute_indicator()) return "";
+
+	for (unsigned i = 0; i < ranges.size(); ++i)
+	{
+		Chart chart(ranges, slices[0], strategy.data_length());
+		const char *error = nullptr;
+
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned j = 0; j < iterations && !error; ++j)
+		{
+			error = strategy.execute_indicator(chart, i);
+		}
+		double mean = elapsed_nanos(start) / (double)iterations;
+		if (error) return error;
+
+		out.indicators.push_back({ chart[i].type(), chart[i].label(), mean });
+	}
+
+	return "";
+}
+
+static void print_text(const Strategy& strategy, const std::vector<Profile>& profiles)
+{
+	printf("%s: %d indicators, data length %d, %s\n", strategy.filename().c_str(),
+		strategy.indicator_count(), strategy.data_length(),
+		strategy.is_reentrant() ? "reentrant" : "not reentrant");
+
+	for (const Profile& p : profiles)
+	{
+		printf("\nwindow of %u candles:\n", p.window);
+		printf("\texecute     mean %.0f ns, p50 %.0f ns, p99 %.0f ns, max %.0f ns\n",
+			p.mean, p.p50, p.p99, p.max);
+		printf("\tallocations %.2f per call, %.0f of them for the chart\n",
+			p.allocations, p.chart_allocations);
+
+		for (const IndicatorProfile& ind : p.indicators)
+		{
+			printf("\t%-11s %.0f ns (%s)\n", ind.label ? ind.label : "?", ind.mean,
+				ind.type ? ind.type : "?");
+		}
+	}
+
+	if (!strategy.has_execute_indicator())
+	{
+		printf("\nstrategy does not export execute_indicator, rebuild it to time indicators\n");
+	}
+
+	if (profiles.size() > 1)
+	{
+		// exponent of how execute time grows with the window length
+		const Profile& first = profiles.front();
+		const Profile& last = profiles.back();
+		double scaling = std::log(last.mean / first.mean) / std::log((double)last.window / first.window);
+		printf("\nscaling: execute time grows with window length^%.2f\n", scaling);
+	}
+}
+
+static void print_json(const Strategy& strategy, const std::vector<Profile>& profiles)
+{
+	printf("{\"strategy\":\"%s\",\"indicators\":%d,\"data_length\":%d,\"reentrant\":%s,\"windows\":[",
+		strategy.filename().c_str(), strategy.indicator_count(), strategy.data_length(),
+		strategy.is_reentrant() ? "true" : "false");
+
+	for (unsigned i = 0; i < profiles.size(); ++i)
+	{
+		const Profile& p = profiles[i];
+		printf("%s{\"window\":%u,\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,"
+			"\"allocations\":%.2f,\"chart_allocations\":%.0f,\"indicators\":[",
+			i ? "," : "", p.window, p.mean, p.p50, p.p99, p.max, p.allocations,
+			p.chart_allocations);
+
+		for (unsigned j = 0; j < p.indicators.size(); ++j)
+		{
+			const IndicatorProfile& ind = p.indicators[j];
+			printf("%s{\"type\":\"%s\",\"label\":\"%s\",\"mean_ns\":%.1f}", j ? "," : "",
+				ind.type ? ind.type : "", ind.label ? ind.label : "", ind.mean);
+		}
+		printf("]}");
+	}
+
+	printf("]}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Options opts;
+	if (!parse_options(opts, argc, argv))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	hirzel::logger::init(true, false, "", 0UL);
+
+	// strategies are loaded from the same folder as for daytrender, which is
+	// found the same way whether it was started by an absolute or relative path
+	std::string dir = std::filesystem::absolute(argv[0]).parent_path().string();
+
+	Strategy strategy;
+	try
+	{
+		strategy = Strategy(opts.strategy, dir);
+	}
+	catch (...)
+	{
+		fprintf(stderr, "error: failed to load strategy: %s\n", opts.strategy.c_str());
+		return 1;
+	}
+
+	if (!strategy.is_bound() || strategy.data_length() == 0)
+	{
+		fprintf(stderr, "error: strategy %s is not usable\n", opts.strategy.c_str());
+		return 1;
+	}
+
+	if (opts.ranges.empty()) opts.ranges.assign(strategy.indicator_count(), DEFAULT_RANGE);
+	if (opts.ranges.size() != (size_t)strategy.indicator_count())
+	{
+		fprintf(stderr, "error: strategy expects %d ranges but %zu were given\n",
+			strategy.indicator_count(), opts.ranges.size());
+		return 1;
+	}
+
+	int max_range = *std::max_element(opts.ranges.begin(), opts.ranges.end());
+	unsigned largest_window = (max_range << (SCALING_STEPS - 1)) + strategy.data_length();
+
+	PriceHistory hist;
+	if (opts.candles.empty())
+	{
+		hist = MarketGenerator(MarketModel(), 1, opts.seed).history(largest_window + WINDOW_COUNT);
+	}
+	else
+	{
+		const char *error = read_candles(hist, opts.candles);
+		if (error)
+		{
+			fprintf(stderr, "error: %s\n", error);
+			return 1;
+		}
+	}
+
+	// archived candles may only be long enough for the smaller windows
+	std::vector<Profile> profiles;
+	std::vector<int> ranges = opts.ranges;
+	for (unsigned step = 0; step < SCALING_STEPS; ++step)
+	{
+		Profile p;
+		std::string error = profile(p, strategy, hist, ranges, opts.iterations);
+		if (!error.empty())
+		{
+			if (profiles.empty())
+			{
+				fprintf(stderr, "error: %s\n", error.c_str());
+				return 1;
+			}
+			break;
+		}
+
+		profiles.push_back(std::move(p));
+		for (int& range : ranges) range *= 2;
+	}
+
+	if (opts.json)
+	{
+		print_json(strategy, profiles);
+	}
+	else
+	{
+		print_text(strategy, profiles);
+	}
+
+	// gating on the ranges that were asked for
+	const Profile& base = profiles.front();
+	int status = 0;
+	if (opts.budget > 0.0 && base.mean > opts.budget)
+	{
+		fprintf(stderr, "execute took %.0f ns on average, over the budget of %.0f ns\n",
+			base.mean, opts.budget);
+		status = 1;
+	}
+
+	if (opts.max_allocations > 0.0 && base.allocations > opts.max_allocations)
+	{
+		fprintf(stderr, "execute allocated %.2f times on average, over the limit of %.2f\n",
+			base.allocations, opts.max_allocations);
+		status = 1;
+	}
+
+	return status;
+}
@@ -0,0 +1,135 @@
+#include <util/allocations.h>
+
+// standard library
+#include <execinfo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <new>
+
+namespace daytrender
+{
+	namespace
+	{
+		std::atomic<bool> accounting(false);
+		std::atomic<bool> steady_state(false);
+
+		// hashes of the call stacks already printed
+		std::atomic<uint64_t> reported[STEADY_STATE_REPORT_LIMIT];
+		std::atomic<unsigned> reported_count(0);
+
+		uint64_t hash_stack(void *const *frames, int depth)
+		{
+			uint64_t hash = 14695981039346656037ULL;
+			for (int i = 0; i < depth; ++i)
+			{
+				hash ^= (uint64_t)(size_t)frames[i];
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		/**
+		 * Prints where an allocation was made. It may itself be inside the
+		 * logger, so it writes straight to stderr without allocating or locking.
+		 */
+		void report_allocation(size_t size, unsigned subsystem)
+		{
+			void *frames[STEADY_STATE_STACK_DEPTH];
+			int depth = backtrace(frames, STEADY_STATE_STACK_DEPTH);
+			uint64_t hash = hash_stack(frames, depth);
+
+			unsigned count = reported_count.load(std::memory_order_acquire);
+			if (count > STEADY_STATE_REPORT_LIMIT) count = STEADY_STATE_REPORT_LIMIT;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (reported[i].load(std::memory_order_relaxed) == hash) return;
+			}
+
+			// two threads may both print a stack they hit at the same time,
+			// which is harmless
+			unsigned slot = reported_count.fetch_add(1, std::memory_order_acq_rel);
+			if (slot >= STEADY_STATE_REPORT_LIMIT) return;
+			reported[slot].store(hash, std::memory_order_relaxed);
+
+			char header[160];
+			int length = snprintf(header, sizeof(header),
+				"steady state: %zu byte allocation by %s during a tick at:\n",
+				size, alloc_subsystem_name(subsystem));
+			if (write(STDERR_FILENO, header, length) < 0) return;
+
+			// the first frames are this function and the hook
+			backtrace_symbols_fd(frames + 2, depth > 2 ? depth - 2 : 0, STDERR_FILENO);
+		}
+	}
+
+	void set_allocation_accounting(bool enabled)
+	{
+		accounting.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool is_accounting_allocations()
+	{
+		return accounting.load(std::memory_order_relaxed);
+	}
+
+	void set_steady_state(bool enabled)
+	{
+		if (enabled)
+		{
+			// the first backtrace loads libgcc, which shouldn't happen mid tick
+			void *frame;
+			backtrace(&frame, 1);
+			set_allocation_accounting(true);
+		}
+
+		steady_state.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool is_steady_state()
+	{
+		return steady_state.load(std::memory_order_relaxed);
+	}
+
+	void account_allocation(size_t size)
+	{
+		if (!accounting.load(std::memory_order_relaxed)) return;
+
+		AllocationContext& context = allocation_context;
+		if (context.busy) return;
+		// the first count of a thread allocates its metric block
+		context.busy = true;
+
+		count_metric((Metric)(METRIC_ALLOCATIONS + context.subsystem));
+		count_metric((Metric)(METRIC_ALLOCATED_BYTES + context.subsystem), size);
+
+		if (context.tick && steady_state.load(std::memory_order_relaxed))
+		{
+			count_metric(METRIC_STEADY_STATE_ALLOCATIONS);
+			report_allocation(size, context.subsystem);
+		}
+
+		context.busy = false;
+	}
+}
+
+// every allocation in the process goes through here, plugins included
+
+void *operator new(size_t size)
+{
+	daytrender::account_allocation(size);
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
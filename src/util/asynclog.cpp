@@ -0,0 +1,314 @@
+#include <util/asynclog.h>
+
+// local includes
+#include <util/ringbuffer.h>
+
+// standard library
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+// external libraries
+#include <hirzel/logger.h>
+
+namespace daytrender
+{
+	namespace
+	{
+		struct LogArg
+		{
+			LogArgType type = LOG_ARG_TRUNCATED;
+			long long i = 0;
+			unsigned long long u = 0;
+			double d = 0.0;
+			const void *p = nullptr;
+			std::string s;
+		};
+
+		class LogArgReader
+		{
+		private:
+			const LogRecord& _record;
+			size_t _pos = 0;
+
+			template <typename T>
+			inline T read()
+			{
+				T value;
+				std::memcpy(&value, _record.args + _pos, sizeof(T));
+				_pos += sizeof(T);
+				return value;
+			}
+
+		public:
+			LogArgReader(const LogRecord& record) : _record(record) {}
+
+			/**
+			 * @return	false if there are no arguments left
+			 */
+			bool next(LogArg& arg)
+			{
+				if (_pos >= _record.size) return false;
+
+				arg.type = (LogArgType)_record.args[_pos];
+				if (arg.type == LOG_ARG_TRUNCATED) return true;
+				_pos += 1;
+
+				switch (arg.type)
+				{
+				case LOG_ARG_INT:
+					arg.i = read<long long>();
+					arg.u = (unsigned long long)arg.i;
+					arg.d = (double)arg.i;
+					break;
+				case LOG_ARG_UINT:
+					arg.u = read<unsigned long long>();
+					arg.i = (long long)arg.u;
+					arg.d = (double)arg.u;
+					break;
+				case LOG_ARG_DOUBLE:
+					arg.d = read<double>();
+					arg.i = (long long)arg.d;
+					arg.u = (unsigned long long)arg.i;
+					break;
+				case LOG_ARG_POINTER:
+					arg.p = read<const void*>();
+					arg.u = (unsigned long long)(size_t)arg.p;
+					arg.i = (long long)arg.u;
+					break;
+				case LOG_ARG_STRING:
+				{
+					size_t length = (unsigned char)_record.args[_pos];
+					arg.s.assign(_record.args + _pos + 1, length);
+					_pos += 1 + length;
+					break;
+				}
+				default:
+					arg.type = LOG_ARG_TRUNCATED;
+					break;
+				}
+
+				return true;
+			}
+		};
+
+		// an argument printed where the format expected something else
+		std::string arg_string(const LogArg& arg)
+		{
+			char buf[64];
+			switch (arg.type)
+			{
+			case LOG_ARG_INT:
+				snprintf(buf, sizeof(buf), "%lld", arg.i);
+				return buf;
+			case LOG_ARG_UINT:
+				snprintf(buf, sizeof(buf), "%llu", arg.u);
+				return buf;
+			case LOG_ARG_DOUBLE:
+				snprintf(buf, sizeof(buf), "%f", arg.d);
+				return buf;
+			case LOG_ARG_POINTER:
+				snprintf(buf, sizeof(buf), "%p", arg.p);
+				return buf;
+			case LOG_ARG_STRING:
+				return arg.s;
+			default:
+				return "...";
+			}
+		}
+
+		std::atomic<bool> log_running(false);
+		std::mutex log_mtx;
+		std::thread log_thread;
+		// created once and never freed so late producers can't use a dead queue
+		MpscRing<LogRecord> *log_queue = nullptr;
+		size_t log_dropped = 0;
+
+		void write_log(const LogRecord& record)
+		{
+			std::string message = format_log(record);
+
+			// the logger stamps the time of writing, which can be well after the
+			// message was submitted, so that time is printed with it
+			char stamp[32];
+			time_t seconds = (time_t)(record.time / 1000000);
+			size_t length = strftime(stamp, sizeof(stamp), "%H:%M:%S", std::localtime(&seconds));
+			snprintf(stamp + length, sizeof(stamp) - length, ".%06lld", record.time % 1000000);
+
+			switch (record.level)
+			{
+			case LOG_LEVEL_DEBUG:
+				DEBUG("[%s] %s", stamp, message);
+				break;
+			case LOG_LEVEL_INFO:
+				INFO("[%s] %s", stamp, message);
+				break;
+			case LOG_LEVEL_WARNING:
+				WARNING("[%s] %s", stamp, message);
+				break;
+			default:
+				ERROR("[%s] %s", stamp, message);
+				break;
+			}
+		}
+
+		void drain_log()
+		{
+			LogRecord record;
+			while (log_queue->pop(record)) write_log(record);
+
+			size_t dropped = log_queue->rejected();
+			if (dropped > log_dropped)
+			{
+				WARNING("log queue was full and dropped %llu messages",
+					(unsigned long long)(dropped - log_dropped));
+				log_dropped = dropped;
+			}
+		}
+
+		void run_log()
+		{
+			while (log_running.load(std::memory_order_relaxed))
+			{
+				size_t before = log_queue->pushed();
+				drain_log();
+
+				// sleeping only once the queue was found empty
+				if (log_queue->pushed() == before)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(ASYNC_LOG_INTERVAL));
+				}
+			}
+		}
+	}
+
+	void submit_log(LogRecord&& record)
+	{
+		record.time = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		if (!log_running.load(std::memory_order_acquire))
+		{
+			write_log(record);
+			return;
+		}
+
+		// a full queue drops the message, which the log thread reports
+		log_queue->push(std::move(record));
+	}
+
+	std::string format_log(const LogRecord& record)
+	{
+		std::string out;
+		LogArgReader reader(record);
+		LogArg arg;
+		char buf[512];
+
+		const char *c = record.format;
+		while (*c)
+		{
+			if (*c != '%')
+			{
+				out += *c++;
+				continue;
+			}
+
+			if (c[1] == '%')
+			{
+				out += '%';
+				c += 2;
+				continue;
+			}
+
+			// flags, width and precision are kept, length modifiers are
+			// replaced by those of the stored type
+			const char *start = c++;
+			while (*c && strchr("-+ #0123456789.", *c)) ++c;
+			std::string spec(start, c - start);
+			// 't' is left out as it prints booleans in the regular logger
+			while (*c && strchr("hlLqjz", *c)) ++c;
+
+			char conv = *c;
+			if (!conv) break;
+			++c;
+
+			if (!reader.next(arg))
+			{
+				out += "(missing)";
+				continue;
+			}
+
+			if (arg.type == LOG_ARG_TRUNCATED)
+			{
+				out += "...";
+				continue;
+			}
+
+			switch (conv)
+			{
+			case 'd':
+			case 'i':
+				snprintf(buf, sizeof(buf), (spec + "lld").c_str(), arg.i);
+				break;
+			case 'u':
+			case 'x':
+			case 'X':
+			case 'o':
+				snprintf(buf, sizeof(buf), (spec + "ll" + conv).c_str(), arg.u);
+				break;
+			case 'c':
+				snprintf(buf, sizeof(buf), (spec + "c").c_str(), (int)arg.i);
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+				snprintf(buf, sizeof(buf), (spec + conv).c_str(), arg.d);
+				break;
+			case 'p':
+				snprintf(buf, sizeof(buf), (spec + "p").c_str(), arg.p);
+				break;
+			case 't':
+				snprintf(buf, sizeof(buf), "%s", arg.u ? "true" : "false");
+				break;
+			case 's':
+				snprintf(buf, sizeof(buf), (spec + "s").c_str(), arg_string(arg).c_str());
+				break;
+			default:
+				snprintf(buf, sizeof(buf), "%s%c", spec.c_str(), conv);
+				break;
+			}
+
+			out += buf;
+		}
+
+		return out;
+	}
+
+	void start_async_log()
+	{
+		std::lock_guard<std::mutex> lock(log_mtx);
+		if (log_running.load()) return;
+
+		if (!log_queue) log_queue = new MpscRing<LogRecord>(ASYNC_LOG_CAPACITY);
+		log_running.store(true, std::memory_order_release);
+		log_thread = std::thread(run_log);
+	}
+
+	void stop_async_log()
+	{
+		std::lock_guard<std::mutex> lock(log_mtx);
+		if (!log_running.load()) return;
+
+		log_running.store(false);
+		log_thread.join();
+		// anything queued while the thread was stopping
+		drain_log();
+	}
+}
@@ -1,5 +1,8 @@
 #include <interface/backtest.h>
 
+// local includes
+#include <util/trace.h>
+
 // standard libarary
 // #include <future>
 // #include <chrono>
@@ -16,14 +19,17 @@ namespace daytrender
 {
 	bool backtest_permutation(PaperAccount& acc, const Asset& asset,
 		const PriceHistory& candles, const Strategy *strat,
-		const std::vector<unsigned>& ranges)
+		const std::vector<int>& ranges)
 	{
+		TRACE_SPAN("backtest_permutation");
+		const std::vector<int>& test_ranges = ranges.empty() ? asset.ranges() : ranges;
+
 		for (long i = 0; i < candles.size() - asset.candle_count(); i++)
 		{
 			PriceHistory slice = candles.slice(i, asset.candle_count());
 
 			acc.update_price(slice.back().close());
-			Result<Chart> res = strat->execute(slice, asset.ranges());
+			Result<Chart> res = strat->execute(slice, test_ranges);
 
 			if (!res)
 			{
@@ -0,0 +1,59 @@
+#include <util/executor.h>
+
+namespace daytrender
+{
+	Executor::Executor(unsigned threads, unsigned priorities) :
+	_tasks(priorities ? priorities : 1)
+	{
+		_threads.reserve(threads);
+		for (unsigned i = 0; i < threads; ++i)
+		{
+			_threads.emplace_back([this]() { run(); });
+		}
+	}
+
+	Executor::~Executor()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		_running = false;
+		lock.unlock();
+		_cv.notify_all();
+
+		// tasks that never ran leave their futures with a broken promise
+		for (std::thread& thread : _threads) thread.join();
+	}
+
+	void Executor::run()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		while (true)
+		{
+			_cv.wait(lock, [&]() { return !_running || _pending > 0; });
+			if (!_running) break;
+
+			// a task is pending, so one of the queues has it
+			auto queue = _tasks.begin();
+			while (queue->empty()) ++queue;
+
+			std::function<void()> task = std::move(queue->front());
+			queue->pop_front();
+			_pending -= 1;
+			lock.unlock();
+
+			task();
+
+			lock.lock();
+		}
+	}
+
+	void Executor::post(unsigned priority, std::function<void()>&& task)
+	{
+		if (priority >= _tasks.size()) priority = _tasks.size() - 1;
+
+		std::unique_lock<std::mutex> lock(_mtx);
+		_tasks[priority].push_back(std::move(task));
+		_pending += 1;
+		lock.unlock();
+		_cv.notify_one();
+	}
+}
@@ -0,0 +1,197 @@
+#include <util/jsonreader.h>
+
+// standard library
+#include <charconv>
+
+namespace daytrender
+{
+	JsonReader::JsonReader(const char *data, size_t size) :
+	_pos(data),
+	_end(data + size)
+	{}
+
+	JsonToken JsonReader::read_string()
+	{
+		const char *start = ++_pos;
+
+		while (true)
+		{
+			const char *quote = (const char*)std::memchr(_pos, '"', _end - _pos);
+			if (!quote)
+			{
+				_pos = _end;
+				return JSON_ERROR;
+			}
+
+			// count the backslashes directly before the quote to see if it is escaped
+			const char *back = quote;
+			while (back > start && back[-1] == '\\') --back;
+			_pos = quote + 1;
+			if (((quote - back) & 1) == 0) break;
+		}
+
+		_str = start;
+		_len = (_pos - 1) - start;
+
+		// a string followed by a colon is a key
+		while (_pos < _end && (unsigned char)*_pos <= ' ') ++_pos;
+		if (_pos < _end && *_pos == ':')
+		{
+			++_pos;
+			return JSON_KEY;
+		}
+
+		return JSON_STRING;
+	}
+
+	JsonToken JsonReader::read_number()
+	{
+		_str = _pos;
+		while (_pos < _end)
+		{
+			char c = *_pos;
+			if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+			{
+				++_pos;
+				continue;
+			}
+			break;
+		}
+		_len = _pos - _str;
+		return JSON_NUMBER;
+	}
+
+	JsonToken JsonReader::read_literal(const char *literal, size_t len, JsonToken token)
+	{
+		if ((size_t)(_end - _pos) < len || std::memcmp(_pos, literal, len))
+		{
+			_pos = _end;
+			return JSON_ERROR;
+		}
+		_str = _pos;
+		_len = len;
+		_pos += len;
+		return token;
+	}
+
+	JsonToken JsonReader::next()
+	{
+		while (_pos < _end)
+		{
+			switch (*_pos)
+			{
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+			case ',':
+			case ':':
+				++_pos;
+				continue;
+
+			case '{':
+				++_pos;
+				++_depth;
+				return JSON_OBJECT;
+
+			case '}':
+				++_pos;
+				--_depth;
+				return JSON_OBJECT_END;
+
+			case '[':
+				++_pos;
+				++_depth;
+				return JSON_ARRAY;
+
+			case ']':
+				++_pos;
+				--_depth;
+				return JSON_ARRAY_END;
+
+			case '"':
+				return read_string();
+
+			case 't':
+				return read_literal("true", 4, JSON_TRUE);
+
+			case 'f':
+				return read_literal("false", 5, JSON_FALSE);
+
+			case 'n':
+				return read_literal("null", 4, JSON_NULL);
+
+			default:
+				if ((*_pos >= '0' && *_pos <= '9') || *_pos == '-') return read_number();
+				_pos = _end;
+				return JSON_ERROR;
+			}
+		}
+
+		return JSON_END;
+	}
+
+	bool JsonReader::skip()
+	{
+		unsigned target = _depth;
+
+		// if the next value is a container, it has to be skipped as a whole
+		JsonToken token = next();
+		if (token == JSON_OBJECT || token == JSON_ARRAY)
+		{
+			// scanning characters is much cheaper than tokenizing the contents
+			while (_pos < _end)
+			{
+				switch (*_pos++)
+				{
+				case '"':
+					--_pos;
+					if (read_string() == JSON_ERROR) return false;
+					break;
+
+				case '{':
+				case '[':
+					++_depth;
+					break;
+
+				case '}':
+				case ']':
+					if (--_depth == target) return true;
+					break;
+
+				default:
+					break;
+				}
+			}
+			return false;
+		}
+
+		return token != JSON_ERROR && token != JSON_END;
+	}
+
+	bool JsonReader::find(const char *key)
+	{
+		unsigned depth = _depth;
+		while (true)
+		{
+			JsonToken token = next();
+			if (token != JSON_KEY || _depth != depth) return false;
+			if (equals(key)) return true;
+			if (!skip()) return false;
+		}
+	}
+
+	double JsonReader::to_double() const
+	{
+		double out = 0.0;
+		std::from_chars(_str, _str + _len, out);
+		return out;
+	}
+
+	long long JsonReader::to_int() const
+	{
+		long long out = 0;
+		std::from_chars(_str, _str + _len, out);
+		return out;
+	}
+}
@@ -0,0 +1,145 @@
+#include <util/latency.h>
+
+// standard library
+#include <stdio.h>
+
+namespace daytrender
+{
+	const char *stage_name(unsigned stage)
+	{
+		static const char *names[] =
+		{
+			"wakeup",
+			"fetch",
+			"evaluate",
+			"sizing",
+			"order",
+			"tick_to_order"
+		};
+
+		return stage < STAGE_COUNT ? names[stage] : "unknown";
+	}
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		clear();
+	}
+
+	LatencyHistogram::LatencyHistogram(const LatencyHistogram& other)
+	{
+		*this = other;
+	}
+
+	LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+	{
+		if (this == &other) return *this;
+
+		clear();
+		merge(other);
+
+		return *this;
+	}
+
+	uint64_t LatencyHistogram::value_of(unsigned index)
+	{
+		if (index < 2 * SUB_BUCKETS) return index;
+
+		unsigned shift = (index - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+		uint64_t sub = (index - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+		uint64_t lower = (SUB_BUCKETS + sub) << shift;
+
+		return lower + (1ULL << shift) - 1;
+	}
+
+	void LatencyHistogram::merge(const LatencyHistogram& other)
+	{
+		for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+		{
+			uint64_t count = other._buckets[i].load(std::memory_order_relaxed);
+			if (count) _buckets[i].fetch_add(count, std::memory_order_relaxed);
+		}
+
+		_count.fetch_add(other.count(), std::memory_order_relaxed);
+		_sum.fetch_add(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+		uint64_t max = other.max();
+		if (max > this->max()) _max.store(max, std::memory_order_relaxed);
+	}
+
+	void LatencyHistogram::clear()
+	{
+		for (std::atomic<uint64_t>& bucket : _buckets) bucket.store(0, std::memory_order_relaxed);
+		_count.store(0, std::memory_order_relaxed);
+		_sum.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t LatencyHistogram::percentile(double ratio) const
+	{
+		uint64_t count = this->count();
+		if (count == 0) return 0;
+
+		uint64_t target = (uint64_t)(ratio * (double)count);
+		if (target == 0) target = 1;
+
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += _buckets[i].load(std::memory_order_relaxed);
+			if (seen >= target)
+			{
+				// the bucket bound can't be above the largest value recorded
+				uint64_t value = value_of(i);
+				return value < max() ? value : max();
+			}
+		}
+
+		return max();
+	}
+
+	std::string LatencyHistogram::to_string() const
+	{
+		char buf[200];
+		snprintf(buf, sizeof(buf), "%llu samples, p50 %.1fus, p99 %.1fus, p99.9 %.1fus, max %.1fus",
+			(unsigned long long)count(), percentile(0.5) / 1e3, percentile(0.99) / 1e3,
+			percentile(0.999) / 1e3, max() / 1e3);
+		return buf;
+	}
+
+	std::string LatencyHistogram::distribution() const
+	{
+		std::string out = "       Value(us)   Percentile   TotalCount\n";
+		uint64_t count = this->count();
+		if (count == 0) return out;
+
+		char buf[80];
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+		{
+			uint64_t bucket = _buckets[i].load(std::memory_order_relaxed);
+			if (bucket == 0) continue;
+
+			seen += bucket;
+			snprintf(buf, sizeof(buf), "%16.3f %12.6f %12llu\n", value_of(i) / 1e3,
+				(double)seen / (double)count, (unsigned long long)seen);
+			out += buf;
+		}
+
+		return out;
+	}
+
+	LatencyTracker::LatencyTracker(unsigned assets) :
+	_histograms(assets * STAGE_COUNT)
+	{}
+
+	LatencyHistogram LatencyTracker::merged(unsigned stage) const
+	{
+		LatencyHistogram out;
+		for (unsigned i = 0; i < assets(); ++i)
+		{
+			out.merge(histogram(i, stage));
+		}
+
+		return out;
+	}
+}
@@ -0,0 +1,99 @@
+#include <util/lowlatency.h>
+
+// standard library
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace daytrender
+{
+#ifdef __linux__
+	static const char *pin_handle(pthread_t handle, int core)
+	{
+		if (core < 0 || core >= CPU_SETSIZE) return "core is out of range";
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+
+		if (pthread_setaffinity_np(handle, sizeof(set), &set)) return "failed to set thread affinity";
+		return nullptr;
+	}
+
+	const char *pin_thread(std::thread& thread, int core)
+	{
+		return pin_handle(thread.native_handle(), core);
+	}
+
+	const char *pin_current_thread(int core)
+	{
+		return pin_handle(pthread_self(), core);
+	}
+
+	const char *lock_memory()
+	{
+		if (mlockall(MCL_CURRENT | MCL_FUTURE)) return "failed to lock memory, missing CAP_IPC_LOCK?";
+
+		volatile char stack[PREFAULT_STACK_SIZE];
+		for (size_t i = 0; i < PREFAULT_STACK_SIZE; i += 4096) stack[i] = 0;
+		(void)stack[0];
+
+		return nullptr;
+	}
+#else
+	const char *pin_thread(std::thread& thread, int core)
+	{
+		return "thread pinning is not supported on this platform";
+	}
+
+	const char *pin_current_thread(int core)
+	{
+		return "thread pinning is not supported on this platform";
+	}
+
+	const char *lock_memory()
+	{
+		return "memory locking is not supported on this platform";
+	}
+#endif
+
+	void JitterStats::record(long long late)
+	{
+		if (late < 0) late = 0;
+
+		unsigned bucket = 0;
+		while (bucket < BUCKET_COUNT - 1 && (1LL << bucket) <= late) bucket += 1;
+
+		_buckets[bucket] += 1;
+		_count += 1;
+		_sum += late;
+		if (late > _max) _max = late;
+	}
+
+	long long JitterStats::percentile(double ratio) const
+	{
+		unsigned long long target = (unsigned long long)(ratio * (double)_count);
+		unsigned long long seen = 0;
+
+		for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += _buckets[i];
+			if (seen >= target && seen > 0) return i ? (1LL << i) - 1 : 0;
+		}
+
+		return _max;
+	}
+
+	std::string JitterStats::to_string() const
+	{
+		char buf[160];
+		snprintf(buf, sizeof(buf), "%llu wakeups, mean %.1fus, p50 <= %lldus, p99 <= %lldus, max %lldus",
+			_count, mean(), percentile(0.5), percentile(0.99), _max);
+		return buf;
+	}
+}
@@ -0,0 +1,122 @@
+#include <util/metrics.h>
+
+// standard library
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace daytrender
+{
+	namespace
+	{
+		struct MetricRegistry
+		{
+			std::mutex mtx;
+			std::vector<std::unique_ptr<MetricBlock>> blocks;
+			std::vector<MetricBlock*> unused;
+		};
+
+		// never destroyed so threads exiting after main still find it
+		MetricRegistry& registry()
+		{
+			static MetricRegistry *registry = new MetricRegistry();
+			return *registry;
+		}
+	}
+
+	const char *client_function_name(unsigned function)
+	{
+		static const char *names[] =
+		{
+			"get_account",
+			"get_price_history",
+			"get_position",
+			"get_quote",
+			"market_order"
+		};
+
+		return function < CLIENT_FUNCTION_COUNT ? names[function] : "unknown";
+	}
+
+	const char *alloc_subsystem_name(unsigned subsystem)
+	{
+		static const char *names[] =
+		{
+			"other",
+			"client",
+			"strategy",
+			"portfolio",
+			"pipeline",
+			"server"
+		};
+
+		return subsystem < ALLOC_SUBSYSTEM_COUNT ? names[subsystem] : "unknown";
+	}
+
+	MetricHandle::MetricHandle()
+	{
+		MetricRegistry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mtx);
+
+		if (!reg.unused.empty())
+		{
+			_block = reg.unused.back();
+			reg.unused.pop_back();
+			return;
+		}
+
+		reg.blocks.push_back(std::make_unique<MetricBlock>());
+		_block = reg.blocks.back().get();
+	}
+
+	MetricHandle::~MetricHandle()
+	{
+		MetricRegistry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mtx);
+		reg.unused.push_back(_block);
+	}
+
+	void collect_metrics(uint64_t *out)
+	{
+		for (unsigned i = 0; i < METRIC_COUNT; ++i) out[i] = 0;
+
+		MetricRegistry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mtx);
+
+		for (const std::unique_ptr<MetricBlock>& block : reg.blocks)
+		{
+			for (unsigned i = 0; i < METRIC_COUNT; ++i)
+			{
+				out[i] += block->values[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	AllocatorStats allocator_stats()
+	{
+		AllocatorStats stats;
+
+	#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+		struct mallinfo2 info = mallinfo2();
+		stats.ok = true;
+		stats.arena = info.arena;
+		stats.mapped = info.hblkhd;
+		stats.in_use = info.uordblks + info.hblkhd;
+		stats.free = info.fordblks;
+	#elif defined(__GLIBC__)
+		// the older fields are ints and wrap above 2GB
+		struct mallinfo info = mallinfo();
+		stats.ok = true;
+		stats.arena = (unsigned)info.arena;
+		stats.mapped = (unsigned)info.hblkhd;
+		stats.in_use = (uint64_t)(unsigned)info.uordblks + (unsigned)info.hblkhd;
+		stats.free = (unsigned)info.fordblks;
+	#endif
+
+		return stats;
+	}
+}
@@ -0,0 +1,81 @@
+#include <util/oandacandles.h>
+
+// local includes
+#include <util/jsonreader.h>
+
+namespace daytrender
+{
+	// reads an object of the form { "o": "1.0", "h": "1.0", "l": "1.0", "c": "1.0" }
+	static bool read_ohlc(JsonReader& json, double *ohlc)
+	{
+		if (json.next() != JSON_OBJECT) return false;
+
+		JsonToken token;
+		while ((token = json.next()) == JSON_KEY)
+		{
+			std::string_view key = json.view();
+			if (key.size() != 1)
+			{
+				if (!json.skip()) return false;
+				continue;
+			}
+
+			json.next();
+			switch (key[0])
+			{
+			case 'o': ohlc[0] = json.to_double(); break;
+			case 'h': ohlc[1] = json.to_double(); break;
+			case 'l': ohlc[2] = json.to_double(); break;
+			case 'c': ohlc[3] = json.to_double(); break;
+			default: break;
+			}
+		}
+
+		return token == JSON_OBJECT_END;
+	}
+
+	const char *decode_oanda_candles(std::string_view body, PriceHistory& hist)
+	{
+		JsonReader json(body);
+		if (json.next() != JSON_OBJECT || !json.find("candles") || json.next() != JSON_ARRAY)
+		{
+			return "no candles were received";
+		}
+
+		unsigned i = 0;
+		JsonToken token;
+		while ((token = json.next()) == JSON_OBJECT)
+		{
+			if (i == hist.size()) return "more candles were received than requested";
+
+			double ohlc[4] = { 0.0, 0.0, 0.0, 0.0 };
+			double volume = 0.0;
+
+			while ((token = json.next()) == JSON_KEY)
+			{
+				if (json.equals("mid"))
+				{
+					if (!read_ohlc(json, ohlc)) return "json failed to parse";
+				}
+				else if (json.equals("volume"))
+				{
+					json.next();
+					volume = json.to_double();
+				}
+				else if (!json.skip())
+				{
+					return "json failed to parse";
+				}
+			}
+
+			if (token != JSON_OBJECT_END) return "json failed to parse";
+
+			hist.get(i++) = { ohlc[0], ohlc[1], ohlc[2], ohlc[3], volume };
+		}
+
+		if (token != JSON_ARRAY_END) return "json failed to parse";
+		if (i != hist.size()) return "not all candles were received";
+
+		return nullptr;
+	}
+}
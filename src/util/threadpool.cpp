@@ -0,0 +1,92 @@
+#include <util/threadpool.h>
+
+// standard library
+#include <algorithm>
+
+namespace daytrender
+{
+	ThreadPool::ThreadPool(unsigned threads)
+	{
+		if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+		_threads.reserve(threads);
+		for (unsigned i = 0; i < threads; ++i)
+		{
+			_threads.emplace_back([this]() { run(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		_running = false;
+		lock.unlock();
+		_work.notify_all();
+
+		for (std::thread& thread : _threads) thread.join();
+	}
+
+	void ThreadPool::run()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		while (true)
+		{
+			_work.wait(lock, [&]() { return !_running || !_batches.empty(); });
+			if (!_running) break;
+
+			std::shared_ptr<Batch> batch = _batches.front();
+			lock.unlock();
+
+			work(*batch);
+			retire(batch);
+
+			lock.lock();
+		}
+	}
+
+	void ThreadPool::work(Batch& batch)
+	{
+		while (true)
+		{
+			unsigned i = batch.next.fetch_add(1, std::memory_order_relaxed);
+			if (i >= batch.count) return;
+
+			(*batch.task)(i);
+
+			if (batch.done.fetch_add(1, std::memory_order_acq_rel) + 1 == batch.count)
+			{
+				std::lock_guard<std::mutex> lock(_mtx);
+				_finished.notify_all();
+			}
+		}
+	}
+
+	void ThreadPool::retire(const std::shared_ptr<Batch>& batch)
+	{
+		// every index has been claimed so no other thread needs to find it
+		std::lock_guard<std::mutex> lock(_mtx);
+		auto iter = std::find(_batches.begin(), _batches.end(), batch);
+		if (iter != _batches.end()) _batches.erase(iter);
+	}
+
+	void ThreadPool::run(unsigned count, const std::function<void(unsigned)>& task)
+	{
+		if (count == 0) return;
+
+		std::shared_ptr<Batch> batch = std::make_shared<Batch>(&task, count);
+
+		std::unique_lock<std::mutex> lock(_mtx);
+		_batches.push_back(batch);
+		lock.unlock();
+		_work.notify_all();
+
+		work(*batch);
+		retire(batch);
+
+		lock.lock();
+		_finished.wait(lock, [&]()
+		{
+			return batch->done.load(std::memory_order_acquire) == count;
+		});
+	}
+}
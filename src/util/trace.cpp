@@ -0,0 +1,171 @@
+#include <util/trace.h>
+
+// standard library
+#include <stdio.h>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace daytrender
+{
+	std::atomic<bool> trace_flag(false);
+
+	namespace
+	{
+		/**
+		 * Spans of one thread. Only the owning thread writes. Each slot is a
+		 * seqlock, so readers drop any slot that was being overwritten while
+		 * they copied it.
+		 */
+		struct TraceRing
+		{
+			struct Slot
+			{
+				// 2 * pos + 1 while span pos is written, 2 * pos + 2 once it is
+				std::atomic<size_t> seq{ 0 };
+				std::atomic<const char*> name;
+				std::atomic<long long> start;
+				std::atomic<long long> duration;
+			};
+
+			unsigned tid;
+			std::atomic<size_t> end;
+			Slot slots[TRACE_RING_CAPACITY];
+
+			TraceRing(unsigned tid) : tid(tid), end(0) {}
+		};
+
+		struct TraceEvent
+		{
+			const char *name;
+			long long start;
+			long long duration;
+		};
+
+		struct TraceRegistry
+		{
+			std::mutex mtx;
+			std::vector<std::unique_ptr<TraceRing>> rings;
+		};
+
+		// never destroyed so threads exiting after main still find it
+		TraceRegistry& registry()
+		{
+			static TraceRegistry *registry = new TraceRegistry();
+			return *registry;
+		}
+
+		// rings are kept after their thread exits so its spans still get written
+		thread_local TraceRing *thread_ring = nullptr;
+
+		std::atomic<bool> trace_requested(false);
+
+		TraceRing *create_ring()
+		{
+			TraceRegistry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mtx);
+
+			reg.rings.push_back(std::make_unique<TraceRing>(reg.rings.size() + 1));
+			return reg.rings.back().get();
+		}
+
+		void copy_events(const TraceRing& ring, std::vector<TraceEvent>& out)
+		{
+			size_t end = ring.end.load(std::memory_order_acquire);
+			size_t begin = end > TRACE_RING_CAPACITY ? end - TRACE_RING_CAPACITY : 0;
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				const TraceRing::Slot& slot = ring.slots[i % TRACE_RING_CAPACITY];
+				size_t seq = slot.seq.load(std::memory_order_acquire);
+				// the writer has lapped the slot already
+				if (seq != 2 * i + 2) continue;
+
+				TraceEvent event = { slot.name.load(std::memory_order_relaxed),
+					slot.start.load(std::memory_order_relaxed),
+					slot.duration.load(std::memory_order_relaxed) };
+
+				// the fence keeps the copy before the check, and the copy is only
+				// whole if the writer didn't start on the slot in the meantime
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+				out.push_back(event);
+			}
+		}
+	}
+
+	void trace_record(const char *name, long long start, long long end)
+	{
+		TraceRing *ring = thread_ring;
+		if (!ring)
+		{
+			ring = create_ring();
+			thread_ring = ring;
+		}
+
+		size_t pos = ring->end.load(std::memory_order_relaxed);
+		TraceRing::Slot& slot = ring->slots[pos % TRACE_RING_CAPACITY];
+
+		// marking the slot as being written before any of it changes, which
+		// readers see if they see any of the new values
+		slot.seq.store(2 * pos + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.duration.store(end - start, std::memory_order_relaxed);
+		slot.seq.store(2 * pos + 2, std::memory_order_release);
+		ring->end.store(pos + 1, std::memory_order_release);
+	}
+
+	std::string trace_json()
+	{
+		std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		std::vector<TraceEvent> events;
+		char buf[256];
+		bool first = true;
+
+		TraceRegistry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mtx);
+
+		for (const std::unique_ptr<TraceRing>& ring : reg.rings)
+		{
+			events.clear();
+			copy_events(*ring, events);
+
+			for (const TraceEvent& event : events)
+			{
+				// span names are literals in the source, so they never need escaping
+				snprintf(buf, sizeof(buf), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+					"\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",", event.name, ring->tid,
+					event.start / 1e3, event.duration / 1e3);
+				out += buf;
+				first = false;
+			}
+		}
+
+		out += "\n]}\n";
+
+		return out;
+	}
+
+	const char *write_trace(const std::string& filepath)
+	{
+		std::ofstream stream(filepath);
+		if (!(stream << trace_json())) return "failed to write trace";
+
+		return nullptr;
+	}
+
+	void request_trace()
+	{
+		trace_requested.store(true, std::memory_order_relaxed);
+	}
+
+	bool take_trace_request()
+	{
+		return trace_requested.exchange(false, std::memory_order_relaxed);
+	}
+}